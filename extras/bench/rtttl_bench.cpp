@@ -0,0 +1,655 @@
+/*
+ * Host benchmarks for the platform independent parts of the RTTTL player.
+ *
+ * Build and run with:
+ *   cmake -S . -B build && cmake --build build --target bench
+ *
+ * Also checks that playback never allocates and exits with 1 if it does.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+#include <thread>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "RTTTLCommandQueue.h"
+#include "RTTTLEffects.h"
+#include "RTTTLJitter.h"
+#include "RTTTLMML.h"
+#include "RTTTLNokia.h"
+#include "RTTTLParser.h"
+#include "RTTTLPitch.h"
+#include "RTTTLProgress.h"
+#include "RTTTLRmtEncoder.h"
+#include "RTTTLSequencer.h"
+#include "RTTTLVoice.h"
+
+static const char *songs[] = {
+  "McGyver:d=4,o=4,b=160:8c5,8c5,8c5,8c5,2b,8f#,a,2g,8c5,c5,b,8a,8b,8a,g,e5,2a,b.,8p,8c5,8b,8a,c5,8b,8a,d5,8c5,8b,d5,8c5,8b,e5,8d5,8e5,f#5,b,1g5,8p,8g5,8e5,8c5,8f#5,8d5,8b,8e5,8c5,8a,8d5,8b,8g,c5,b,8c5,8b,8a,8g,a#,a,8g.",
+  "TakeOnMe:d=4,o=4,b=160:8f#5,8f#5,8f#5,8d5,8p,8b,8p,8e5,8p,8e5,8p,8e5,8g#5,8g#5,8a5,8b5,8a5,8a5,8a5,8e5,8p,8d5,8p,8f#5,8p,8f#5,8p,8f#5,8e5,8e5,8f#5,8e5,8f#5,8f#5,8f#5,8d5,8p,8b,8p,8e5,8p,8e5,8p,8e5,8g#5,8g#5,8a5,8b5,8a5,8a5,8a5,8e5,8p,8d5,8p,8f#5,8p,8f#5,8p,8f#5,8e5,8e5",
+  "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#,8c#6,8b,d,e,8b,8a,c#,e,2a",
+  "Tetris:d=4,o=5,b=160:e6,8b,8c6,8d6,16e6,16d6,8c6,8b,a,8a,8c6,e6,8d6,8c6,b,8b,8c6,d6,e6,c6,a,2a,8p,d6,8f6,a6,8g6,8f6,e6,8e6,8c6,e6,8d6,8c6,b,8b,8c6,d6,e6,c6,a,a",
+};
+static const size_t songCount = sizeof(songs) / sizeof(songs[0]);
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedNs(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// Keeps the compiler from optimizing the measured work away.
+static volatile uint32_t sink;
+
+// Every allocation made while counting is on. The C allocation functions are
+// replaced, aligned ones included, which operator new and its aligned form go
+// through as well; on glibc they hand over to its own allocator.
+static std::atomic<bool> counting{false};
+static std::atomic<size_t> allocations{0};
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size) {
+  if (counting) allocations++;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  if (counting) allocations++;
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size) {
+  if (counting) allocations++;
+  return __libc_realloc(p, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+  if (counting) allocations++;
+  return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  if (counting) allocations++;
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **p, size_t alignment, size_t size) {
+  if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  if (counting) allocations++;
+  *p = __libc_memalign(alignment, size);
+  return *p != nullptr ? 0 : ENOMEM;
+}
+}
+#else
+void *operator new(size_t size) {
+  if (counting) allocations++;
+  void *p = malloc(size ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  if (counting) allocations++;
+  return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+  free(p);
+}
+
+#if __cpp_aligned_new
+void *operator new(size_t size, std::align_val_t alignment) {
+  if (counting) allocations++;
+  size_t align = (size_t)alignment;
+  void *p = aligned_alloc(align, (size + align - 1) / align * align);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+  free(p);
+}
+#endif
+#endif
+
+static void benchParse() {
+  const int iterations = 20000;
+  RTTTLParser parser;
+  RTTTLNote note;
+  uint64_t notes = 0;
+  uint32_t sum = 0;
+
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    parser.load(songs[i % songCount]);
+    while (parser.nextNote(note)) {
+      sum += note.frequency + note.duration;
+      notes++;
+    }
+  }
+  double ns = elapsedNs(start);
+  sink = sum;
+
+  printf("parse:     %10.0f notes/s  (%.1f ns/note)\n", notes * 1e9 / ns, ns / notes);
+}
+
+// The same tune in each text format, through the front-end interface.
+static void benchFrontEnds() {
+  const int iterations = 20000;
+  RTTTLParser rtttl;
+  RTTTLMMLParser mml;
+  RTTTLNokiaParser nokia(225);
+  struct {
+    const char * name;
+    RTTTLFrontEnd * format;
+    const char * song;
+  } formats[] = {
+    { "rtttl", &rtttl, songs[2] },
+    { "mml", &mml, "t225l4o6 e8d8<f+g+>c+8<b8de b8a8>c+e<a2" },
+    { "nokia", &nokia, "8e2 8d2 4#f1 4#g1 8#c2 8b1 4d1 4e1 8b1 8a1 4#c1 4e1 2a1" },
+  };
+  RTTTLNote note;
+  uint32_t sum = 0;
+
+  printf("formats:  ");
+  for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+    uint64_t notes = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+      formats[f].format->load(formats[f].song);
+      while (formats[f].format->nextNote(note)) {
+        sum += note.frequency + note.duration;
+        notes++;
+      }
+    }
+    printf(" %s %.1f ns/note%s", formats[f].name, elapsedNs(start) / notes, f + 1 < sizeof(formats) / sizeof(formats[0]) ? "," : "\n");
+  }
+  sink = sum;
+}
+
+static void benchCompile() {
+  const int iterations = 20000;
+  RTTTLNote out[256];
+
+  printf("compile:\n");
+  for (size_t s = 0; s < songCount; s++) {
+    size_t count = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+      count = RTTTLParser::compile(songs[s], out, sizeof(out) / sizeof(out[0]));
+      sink = out[count / 2].frequency;
+    }
+    double ns = elapsedNs(start) / iterations;
+
+    // the same pass without storing the notes
+    RTTTLSongInfo info;
+    start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+      RTTTLParser::inspect(songs[s], info);
+      sink = info.highest;
+    }
+    double inspectNs = elapsedNs(start) / iterations;
+
+    printf("  %-10.*s %4zu notes  %8.0f ns/song  %6zu bytes compiled (%zu bytes/note)  inspect %6.0f ns, "
+           "%6.1f s, %u-%u Hz\n",
+           (int)info.nameLength, info.name, count, ns, count * sizeof(RTTTLNote), sizeof(RTTTLNote), inspectNs,
+           info.duration / 1e6, info.lowest, info.highest);
+  }
+}
+
+// Simulates a number of players on a virtual clock. Every event is one note
+// change: advance to the earliest deadline, then service every due player the
+// same way the playback task does.
+static void benchScheduler(size_t players) {
+  const uint64_t events = 2000000;
+  std::vector<RTTTLSequencer> sequencers(players);
+  RTTTLNote note;
+  uint32_t sum = 0;
+  uint64_t done = 0;
+  int64_t now = 0;
+
+  for (size_t p = 0; p < players; p++) {
+    sequencers[p].load(songs[p % songCount]);
+    sequencers[p].start(now + (int64_t)p * 1000);
+  }
+
+  Clock::time_point start = Clock::now();
+  while (done < events) {
+    int64_t next = sequencers[0].nextDeadline();
+    for (size_t p = 1; p < players; p++) {
+      if (sequencers[p].nextDeadline() < next) next = sequencers[p].nextDeadline();
+    }
+    now = next;
+
+    for (size_t p = 0; p < players; p++) {
+      RTTTLSequencer &sequencer = sequencers[p];
+      if (!sequencer.due(now)) {
+        continue;
+      }
+      if (!sequencer.nextNote(note)) {
+        // loop the song so the player never runs dry
+        sequencer.start(now);
+        continue;
+      }
+      sum += note.frequency;
+      done++;
+    }
+  }
+  double ns = elapsedNs(start);
+  sink = sum;
+
+  printf("  %3zu players  %8.1f ns/event  (%zu bytes/player)\n",
+         players, ns / done, sizeof(RTTTLSequencer));
+}
+
+// Cost of a control call passing through the command queue, without the task
+// notification that goes with it on the ESP32.
+static void benchCommands() {
+  const int iterations = 10000000;
+  RTTTLCommandQueue queue;
+  RTTTLCommand command = {};
+  uint32_t sum = 0;
+
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    command.type = RTTTL_COMMAND_VOLUME;
+    command.value = i;
+    queue.push(command);
+    queue.pop(command);
+    sum += command.value;
+  }
+  sink = sum;
+
+  printf("commands:  %8.1f ns/push+pop\n", elapsedNs(start) / iterations);
+}
+
+// Cost of one sweep step, excluding the LEDC update it leads to.
+static void benchSweep() {
+  const uint32_t steps = 10000000;
+  RTTTLSweep sweep;
+  uint32_t sum = 0;
+
+  printf("sweep:    ");
+  for (int curve = RTTTL_SWEEP_LINEAR; curve <= RTTTL_SWEEP_EXPONENTIAL; curve++) {
+    sweep.start(NOTE_C4, NOTE_C7, steps, (RTTTLSweepCurve)curve);
+    Clock::time_point start = Clock::now();
+    while (sweep.active()) {
+      sum += sweep.next();
+    }
+    printf(" %6.2f ns/step %s", elapsedNs(start) / steps,
+           curve == RTTTL_SWEEP_LINEAR ? "linear," : "exponential");
+  }
+  printf("\n");
+  sink = sum;
+}
+
+// One vibrato or tremolo update: advance the phase and read the sine.
+static void benchLfo() {
+  const uint32_t steps = 10000000;
+  RTTTLLfo lfo;
+  int32_t sum = 0;
+
+  lfo.set(5500, RTTTL_EFFECT_RATE, 65536 / 20);
+  Clock::time_point start = Clock::now();
+  for (uint32_t i = 0; i < steps; i++) {
+    lfo.advance(1);
+    sum += lfo.value();
+  }
+  printf("lfo:       %8.2f ns/update\n", elapsedNs(start) / steps);
+  sink = sum;
+}
+
+// Worst error against the requested frequency over the note range with a
+// fixed 10 bit resolution on the 80 MHz clock, against the clock and
+// resolution picked per note.
+static void benchPitch() {
+  static const uint32_t clocks[] = { 80000000, 1000000 };
+  const int lowest = 23;  // B0
+  const int highest = 99; // D#8
+  RTTTLPitch pitch(clocks, 2, RTTTL_MIN_RESOLUTION, 14);
+  RTTTLTimerSetting setting;
+  double fixedWorst = 0;
+  double plannedWorst = 0;
+  int fixedMissing = 0;
+  int plannedMissing = 0;
+
+  for (int key = lowest; key <= highest; key++) {
+    uint16_t frequency = (uint16_t)(440.0 * pow(2.0, (key - 69) / 12.0) + 0.5);
+
+    uint64_t exact = ((uint64_t)clocks[0] << 8) / ((uint64_t)frequency << 10);
+    if (exact < RTTTL_DIVIDER_MIN || exact > RTTTL_DIVIDER_MAX) {
+      fixedMissing++;
+    } else {
+      uint32_t made = RTTTLPitch::actual(clocks[0], RTTTLPitch::divider(clocks[0], frequency, 10), 10);
+      fixedWorst = fmax(fixedWorst, fabs(1200 * log2(made / 1000.0 / frequency)));
+    }
+
+    if (pitch.plan(frequency, setting)) {
+      uint32_t made = RTTTLPitch::actual(clocks[setting.clock], setting.divider, setting.resolution);
+      plannedWorst = fmax(plannedWorst, fabs(1200 * log2(made / 1000.0 / frequency)));
+    } else {
+      plannedMissing++;
+    }
+  }
+
+  const int iterations = 1000000;
+  uint32_t sum = 0;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    pitch.plan(NOTE_C4 + (i & 1023), setting);
+    sum += setting.divider;
+  }
+  sink = sum;
+
+  printf("pitch:     B0-D#8 worst error %.2f cents, %d notes unplayable at 10 bit;"
+         " %.2f cents, %d unplayable planned  %.0f ns/plan\n",
+         fixedWorst, fixedMissing, plannedWorst, plannedMissing, elapsedNs(start) / iterations);
+}
+
+// Cost of the optional edge timing instrumentation, and the edge lateness of
+// a short song played in real time with sleep_until on the host.
+static void benchJitter() {
+  const int iterations = 1000000;
+  RTTTLJitter jitter;
+
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    jitter.record(0, i % 3000);
+  }
+  printf("jitter:    %8.1f ns/record", elapsedNs(start) / iterations);
+
+  start = Clock::now();
+  RTTTLJitterStats stats = jitter.stats();
+  printf("  %8.0f ns/stats\n", elapsedNs(start));
+  sink = stats.p99;
+
+  RTTTLSequencer sequencer;
+  RTTTLNote note;
+  jitter.reset();
+  sequencer.load("Nokia:d=4,o=5,b=900:8e6,8d6,f#,g#,8c#6,8b,d,e,8b,8a,c#,e,2a");
+  sequencer.start(RTTTLJitter::now());
+  for (;;) {
+    int64_t scheduled = sequencer.nextDeadline();
+    std::this_thread::sleep_until(Clock::time_point(std::chrono::microseconds(scheduled)));
+    if (!sequencer.nextNote(note)) {
+      break;
+    }
+    jitter.record(scheduled, RTTTLJitter::now());
+  }
+
+  stats = jitter.stats();
+  printf("  host sleep_until lateness over %u edges: min %d us, max %d us, mean %d us, p99 %d us\n",
+         stats.samples, stats.min, stats.max, stats.mean, stats.p99);
+  printf("  histogram (%u us buckets):", jitter.bucketWidth());
+  for (size_t i = 0; i < jitter.bucketCount(); i++) {
+    printf(" %u", jitter.bucket(i));
+  }
+  printf("\n");
+}
+
+// Stands in for LEDC on the host: works out the timer settings of a song when
+// it is planned and looks them up for every note, like RTTTLLedcOutput.
+class BenchOutput : public RTTTLOutput {
+
+private:
+  RTTTLPitch &pitch;
+  RTTTLTimerSetting setting;
+
+public:
+  uint32_t sum = 0;
+
+  BenchOutput(RTTTLPitch &pitch) : pitch(pitch) { }
+
+  bool begin() override { return true; }
+  void end() override { }
+  void clear() override { pitch.clear(); }
+  void prepare(uint16_t frequency) override { pitch.add(frequency); }
+  bool tone(uint16_t frequency) override {
+    bool made = pitch.lookup(frequency, setting);
+    sum += setting.divider;
+    return made;
+  }
+  void retune(uint32_t frequency) override { sum += frequency; }
+  uint32_t fullScale() const override { return 1u << setting.resolution; }
+  void setDuty(uint32_t duty) override { sum += duty; }
+};
+
+// Runs the playback task's portable work between play() and the end of a
+// song with allocation counting on: control calls through the queue, loading
+// text in every format, compiled songs and a sweep, and RTTTLVoice, which the
+// player itself uses, planning each song for the output and stepping every
+// note with portamento, vibrato, tremolo and position. Jitter recording and
+// the RMT encoder follow. The task's loop around the voice, the outputs and
+// the RTOS calls need ESP-IDF and are not covered. Only construction and
+// compiling into caller buffers come before.
+static bool checkAllocations() {
+  static const uint32_t clocks[] = { 80000000, 1000000 };
+  static RTTTLNote notes[256];
+  static RTTTLCommandQueue queue;
+  static RTTTLVoice voice;
+  static RTTTLMMLParser mml;
+  static RTTTLNokiaParser nokia;
+  static RTTTLPitch pitch(clocks, 2, RTTTL_MIN_RESOLUTION, 14);
+  static BenchOutput output(pitch);
+  static RTTTLRmtEncoder encoder;
+  static RTTTLJitter jitter;
+  RTTTLCommand command = {};
+  RTTTLSong song;
+  RTTTLVoiceNote step;
+  uint32_t symbols[32];
+  uint32_t sum = 0;
+  int64_t now = 0;
+
+  RTTTLParser::compile(songs[0], notes, sizeof(notes) / sizeof(notes[0]), song);
+  voice.setPortamento(40, RTTTL_SWEEP_EXPONENTIAL);
+  voice.setVibrato(5500, 65536 / 100);
+  voice.setTremolo(4000, 65536 / 4);
+
+  allocations = 0;
+  counting = true;
+  for (int round = 0; round < 5; round++) {
+    command.type = RTTTL_COMMAND_LOAD_TEXT;
+    command.text = songs[round % songCount];
+    queue.push(command);
+    command.type = RTTTL_COMMAND_PLAY;
+    queue.push(command);
+    while (queue.pop(command)) sum += command.type;
+
+    if (round == 4) {
+      voice.sweep(NOTE_C4, NOTE_C7, 1500, RTTTL_SWEEP_EXPONENTIAL, now);
+    } else {
+      if (round == 1) {
+        voice.load("t140 l8 o5 c d e&e f+ g4 < a > b-", &mml);
+      } else if (round == 2) {
+        voice.load("8#f2 8e2 4c2 4d2", &nokia);
+      } else if (round == 3) {
+        voice.load(song);
+      } else {
+        voice.load(command.text, nullptr);
+      }
+      voice.plan(output);
+      voice.start(now);
+    }
+
+    // the task's loop: sleep until the next deadline, then step what is due
+    bool sounding = false;
+    while (true) {
+      if (!voice.due(now)) {
+        uint16_t frequency;
+        if (voice.stepGlide(now, frequency)) output.retune(frequency);
+        if (sounding && voice.stepLfo(now)) sum += voice.vibrato().value() + voice.tremolo().value();
+        now = voice.nextDeadline(sounding);
+        continue;
+      }
+      if (!voice.next(step)) break;
+      sounding = step.note.frequency != 0;
+      if (sounding) {
+        voice.startNote(step);
+        output.tone(step.from ? step.from : step.note.frequency);
+      }
+      sum += RTTTLProgress::perMille(voice.progress().read(now + 1000));
+      jitter.record(step.scheduled, now + 5);
+    }
+    voice.stop();
+  }
+  encoder.song().load(song);
+  encoder.start();
+  size_t n;
+  while ((n = encoder.encode(symbols, 32)) > 0) sum += symbols[n - 1];
+  sum += jitter.stats().max;
+  counting = false;
+  sink = sum + output.sum;
+
+  size_t made = allocations;
+  printf("allocations during playback: %zu%s\n", made, made ? "  FAIL" : "");
+  return made == 0;
+}
+
+// Cost of a position() read, and a writer thread publishing notes as fast as
+// it can while the main thread checks that no read mixes two of them.
+static bool checkProgress() {
+  const int iterations = 10000000;
+  const uint32_t writes = 2000000;
+  static RTTTLProgress progress;
+  RTTTLPosition position;
+  uint64_t sum = 0;
+
+  // a note of 200 ms song time played at half speed, half way through
+  progress.setLength(2000, 0);
+  progress.publish(3, 1000, 200, 400, 0);
+  position = progress.read(200000);
+  bool ok = position.elapsed == 1100000 && RTTTLProgress::perMille(position) == 550;
+
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sum += progress.read(i).elapsed;
+  }
+  sink = sum;
+  double ns = elapsedNs(start) / iterations;
+
+  // every note starts at index * 100 ms, a torn read breaks that
+  progress.stop();
+  std::atomic<bool> writing{true};
+  std::thread writer([&]() {
+    for (uint32_t i = 0; i < writes; i++) {
+      progress.publish(i, i * 100, 100, 100, 0);
+    }
+    writing = false;
+  });
+  size_t reads = 0;
+  size_t torn = 0;
+  while (writing) {
+    position = progress.read(0);
+    if (position.elapsed != position.index * 100000ULL) torn++;
+    reads++;
+  }
+  writer.join();
+  ok = ok && torn == 0;
+
+  printf("position:  %8.1f ns/read, %zu reads against %u writes, %zu torn%s\n", ns, reads, writes, torn,
+         ok ? "" : "  FAIL");
+  return ok;
+}
+
+// Songs with an empty or missing header must play the same notes as the
+// same song with the defaults written out.
+static bool checkHeaders() {
+  static const char *const pairs[][2] = {
+    { "x:8e6,8d6", "x:d=4,o=6,b=63:8e6,8d6" },
+    { "x::8e6,8d6", "x:d=4,o=6,b=63:8e6,8d6" },
+    { "x: c, p, 2g5", "x:d=4,o=6,b=63:c,p,2g5" },
+    { "x: d = 8 , b=120: c,d", "x:d=8,o=6,b=120:c,d" },
+  };
+  const size_t count = sizeof(pairs) / sizeof(pairs[0]);
+  size_t failed = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    RTTTLParser bare, full;
+    RTTTLNote a, b;
+    size_t notes = 0;
+    bool same = bare.load(pairs[i][0]) && full.load(pairs[i][1]);
+    while (same) {
+      bool more = bare.nextNote(a);
+      if (more != full.nextNote(b)) {
+        same = false;
+      } else if (!more) {
+        break;
+      } else {
+        same = a.frequency == b.frequency && a.duration == b.duration;
+        notes++;
+      }
+    }
+    if (!same || notes == 0) {
+      printf("headers:   \"%s\" does not play as \"%s\"  FAIL\n", pairs[i][0], pairs[i][1]);
+      failed++;
+    }
+  }
+  if (failed == 0) {
+    printf("headers:   %zu songs without a full header parse as written out\n", count);
+  }
+  return failed == 0;
+}
+
+int main() {
+  benchParse();
+  benchFrontEnds();
+  benchCompile();
+
+  printf("scheduler:\n");
+  benchScheduler(1);
+  benchScheduler(8);
+  benchScheduler(64);
+
+  benchCommands();
+  benchSweep();
+  benchLfo();
+  benchPitch();
+  benchJitter();
+
+  bool ok = checkProgress();
+  ok = checkHeaders() && ok;
+  return checkAllocations() && ok ? 0 : 1;
+}
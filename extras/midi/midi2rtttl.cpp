@@ -0,0 +1,536 @@
+/*
+ * Converts a Standard MIDI File into a song for the RTTTL player.
+ *
+ * The MIDI file is reduced to one voice, keeping the highest (or lowest)
+ * sounding note at any time, optionally from a single channel only. The result
+ * is written to stdout either as RTTTL text quantized to RTTTL note lengths, or
+ * as a compiled RTTTLNote array with millisecond durations that can be played
+ * with loadSong(const RTTTLSong &) without parsing on the device.
+ *
+ * Build with:
+ *   cmake -S . -B build && cmake --build build --target midi2rtttl
+ *
+ * Usage:
+ *   midi2rtttl [options] file.mid
+ *     -c N   only use MIDI channel N (1-16), default all but 10 (drums)
+ *     -l     keep the lowest note instead of the highest
+ *     -t N   transpose by N semitones
+ *     -q N   snap note edges to 1/N notes before reducing, e.g. 16
+ *     -v     carry velocities over as RTX note volumes
+ *     -a     write a compiled RTTTLNote array instead of RTTTL text
+ *     -n S   name of the song, default the file name
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "RTTTLParser.h"
+
+struct MidiEvent {
+  uint64_t tick;
+  uint8_t on;       // 0 for note off, so offs sort before ons at the same tick
+  uint8_t channel;
+  uint8_t key;
+  uint8_t velocity;
+};
+
+struct TempoChange {
+  uint64_t tick;
+  uint32_t usPerQuarter;
+};
+
+// A stretch of the reduced voice, key -1 is a pause.
+struct Segment {
+  uint64_t start;   // microseconds
+  uint64_t end;
+  int key;
+  uint8_t velocity;
+};
+
+struct Midi {
+  uint16_t division = 0;
+  std::vector<MidiEvent> events;
+  std::vector<TempoChange> tempos;
+};
+
+class Reader {
+
+private:
+  const uint8_t * p;
+  const uint8_t * end;
+
+public:
+  bool ok = true;
+
+  Reader(const uint8_t *data, size_t size) : p(data), end(data + size) { }
+
+  bool atEnd() const { return p >= end; }
+  size_t left() const { return end - p; }
+  const uint8_t *position() const { return p; }
+
+  uint8_t byte() {
+    if (p >= end) {
+      ok = false;
+      return 0;
+    }
+    return *p++;
+  }
+
+  uint32_t big(int bytes) {
+    uint32_t value = 0;
+    while (bytes--) {
+      value = (value << 8) | byte();
+    }
+    return value;
+  }
+
+  uint32_t vlq() {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+      uint8_t b = byte();
+      value = (value << 7) | (b & 0x7F);
+      if (!(b & 0x80)) {
+        return value;
+      }
+    }
+    ok = false;
+    return value;
+  }
+
+  void skip(size_t bytes) {
+    if (bytes > left()) {
+      ok = false;
+      p = end;
+    } else {
+      p += bytes;
+    }
+  }
+};
+
+static bool readTrack(Reader &track, Midi &midi) {
+  uint64_t tick = 0;
+  uint8_t status = 0;
+
+  while (!track.atEnd() && track.ok) {
+    tick += track.vlq();
+    uint8_t b = track.byte();
+
+    if (b == 0xFF) {
+      uint8_t type = track.byte();
+      uint32_t length = track.vlq();
+      if (type == 0x51 && length == 3) {
+        TempoChange tempo = { tick, track.big(3) };
+        midi.tempos.push_back(tempo);
+      } else if (type == 0x2F) {
+        break;
+      } else {
+        track.skip(length);
+      }
+      continue;
+    }
+    if (b == 0xF0 || b == 0xF7) {
+      track.skip(track.vlq());
+      continue;
+    }
+
+    // running status repeats the last channel message type
+    uint8_t data;
+    if (b & 0x80) {
+      status = b;
+      data = track.byte();
+    } else if (status != 0) {
+      data = b;
+    } else {
+      return false;
+    }
+
+    uint8_t type = status & 0xF0;
+    if (type == 0x80 || type == 0x90) {
+      uint8_t velocity = track.byte();
+      MidiEvent event = { tick, (uint8_t)(type == 0x90 && velocity > 0), (uint8_t)(status & 0x0F), (uint8_t)(data & 0x7F), velocity };
+      midi.events.push_back(event);
+    } else if (type != 0xC0 && type != 0xD0) {
+      track.byte();
+    }
+  }
+  return track.ok;
+}
+
+static bool readMidi(const std::vector<uint8_t> &file, Midi &midi) {
+  Reader reader(file.data(), file.size());
+
+  if (reader.left() < 14 || memcmp(reader.position(), "MThd", 4) != 0) {
+    return false;
+  }
+  reader.skip(4);
+  uint32_t headerLength = reader.big(4);
+  reader.big(2); // format, all of them are merged into one timeline
+  uint16_t tracks = reader.big(2);
+  midi.division = reader.big(2);
+  reader.skip(headerLength - 6);
+
+  for (uint16_t i = 0; i < tracks && reader.ok && !reader.atEnd(); i++) {
+    bool isTrack = reader.left() >= 8 && memcmp(reader.position(), "MTrk", 4) == 0;
+    reader.skip(4);
+    uint32_t length = reader.big(4);
+    if (length > reader.left()) {
+      return false;
+    }
+    if (isTrack) {
+      Reader track(reader.position(), length);
+      if (!readTrack(track, midi)) {
+        return false;
+      }
+    }
+    reader.skip(length);
+  }
+
+  std::stable_sort(midi.events.begin(), midi.events.end(), [](const MidiEvent &a, const MidiEvent &b) {
+    return a.tick != b.tick ? a.tick < b.tick : a.on < b.on;
+  });
+  std::stable_sort(midi.tempos.begin(), midi.tempos.end(), [](const TempoChange &a, const TempoChange &b) {
+    return a.tick < b.tick;
+  });
+  return reader.ok && midi.division != 0;
+}
+
+// Turns ticks into microseconds through the tempo map. Calls have to come in
+// increasing tick order, which keeps every conversion O(1).
+class Timeline {
+
+private:
+  const Midi &midi;
+  size_t next = 0;
+  uint64_t baseTick = 0;
+  double baseUs = 0;
+  double usPerTick;
+  bool smpte;
+
+public:
+  Timeline(const Midi &midi) : midi(midi) {
+    smpte = midi.division & 0x8000;
+    if (smpte) {
+      // frames per second times ticks per frame, no tempo involved
+      int fps = -(int8_t)(midi.division >> 8);
+      usPerTick = 1e6 / (fps * (midi.division & 0xFF));
+    } else {
+      usPerTick = 500000.0 / midi.division;
+    }
+  }
+
+  uint64_t at(uint64_t tick) {
+    while (!smpte && next < midi.tempos.size() && midi.tempos[next].tick <= tick) {
+      baseUs += (midi.tempos[next].tick - baseTick) * usPerTick;
+      baseTick = midi.tempos[next].tick;
+      usPerTick = (double)midi.tempos[next].usPerQuarter / midi.division;
+      next++;
+    }
+    return (uint64_t)(baseUs + (tick - baseTick) * usPerTick + 0.5);
+  }
+};
+
+struct Options {
+  int channel = -1;
+  bool lowest = false;
+  int transpose = 0;
+  int quantize = 0;
+  bool velocity = false;
+  bool array = false;
+  std::string name;
+};
+
+// Keeps one note at a time: whenever the set of held keys changes the highest
+// (or lowest) of them becomes the sounding note.
+static std::vector<Segment> reduce(Midi &midi, const Options &options) {
+  std::vector<Segment> segments;
+  int held[128] = {};
+  uint8_t velocities[128] = {};
+  Timeline timeline(midi);
+  int sounding = -1;
+  uint64_t start = 0;
+
+  if (options.quantize > 0 && !(midi.division & 0x8000)) {
+    uint64_t grid = (uint64_t)midi.division * 4 / options.quantize;
+    if (grid == 0) grid = 1;
+    // a note is never snapped shorter than one grid step, or its off would
+    // sort before its on and leave it hanging
+    static uint64_t lastOn[16][128];
+    for (MidiEvent &event : midi.events) {
+      uint64_t snapped = (event.tick + grid / 2) / grid * grid;
+      if (event.on) {
+        lastOn[event.channel][event.key] = snapped;
+      } else if (snapped <= lastOn[event.channel][event.key]) {
+        snapped = lastOn[event.channel][event.key] + grid;
+      }
+      event.tick = snapped;
+    }
+    std::stable_sort(midi.events.begin(), midi.events.end(), [](const MidiEvent &a, const MidiEvent &b) {
+      return a.tick != b.tick ? a.tick < b.tick : a.on < b.on;
+    });
+  }
+
+  for (size_t i = 0; i < midi.events.size(); ) {
+    uint64_t tick = midi.events[i].tick;
+    bool struck = false;
+
+    // apply everything that happens at this tick before picking the note
+    for (; i < midi.events.size() && midi.events[i].tick == tick; i++) {
+      const MidiEvent &event = midi.events[i];
+      if (options.channel >= 0 ? event.channel != options.channel : event.channel == 9) {
+        continue;
+      }
+      if (event.on) {
+        held[event.key]++;
+        velocities[event.key] = event.velocity;
+        struck |= event.key == sounding;
+      } else if (held[event.key] > 0) {
+        held[event.key]--;
+      }
+    }
+
+    int top = -1;
+    if (options.lowest) {
+      for (int key = 0; key < 128 && top < 0; key++) {
+        if (held[key]) top = key;
+      }
+    } else {
+      for (int key = 127; key >= 0 && top < 0; key--) {
+        if (held[key]) top = key;
+      }
+    }
+
+    // striking the sounding key again starts a new note
+    if (top != sounding || (struck && top >= 0)) {
+      uint64_t now = timeline.at(tick);
+      if (now > start && (sounding >= 0 || !segments.empty())) {
+        Segment segment = { start, now, sounding, sounding >= 0 ? velocities[sounding] : (uint8_t)0 };
+        segments.push_back(segment);
+      }
+      start = now;
+      sounding = top;
+    }
+  }
+  return segments;
+}
+
+static uint16_t frequency(int key) {
+  return (uint16_t)(440.0 * pow(2.0, (key - 69) / 12.0) + 0.5);
+}
+
+static int volumeOf(const Segment &segment, const Options &options) {
+  if (!options.velocity || segment.key < 0) {
+    return RTTTL_NOTE_VOLUME_MAX;
+  }
+  return (segment.velocity * RTTTL_NOTE_VOLUME_MAX + 63) / 127;
+}
+
+static void writeArray(const std::vector<Segment> &segments, const Options &options) {
+  // round the edges rather than each length so the error never adds up
+  uint64_t origin = segments.empty() ? 0 : segments[0].start;
+  size_t count = 0;
+
+  printf("// %s, converted by midi2rtttl\n", options.name.c_str());
+  printf("const RTTTLNote %s[] = {\n", options.name.c_str());
+  for (const Segment &segment : segments) {
+    uint64_t from = (segment.start - origin + 500) / 1000;
+    uint64_t to = (segment.end - origin + 500) / 1000;
+    if (to == from) {
+      continue;
+    }
+    int key = segment.key + options.transpose;
+    printf("  { %u, %d, 0, %u },\n", segment.key >= 0 && key >= 0 && key < 128 ? frequency(key) : 0,
+           RTTTL_NOTE_VOLUME_MAX - volumeOf(segment, options), (unsigned)(to - from));
+    count++;
+  }
+  printf("};\n");
+  printf("const size_t %sCount = %zu;\n", options.name.c_str(), count);
+}
+
+static const char *noteNames[12] = { "c", "c#", "d", "d#", "e", "f", "f#", "g", "g#", "a", "a#", "b" };
+
+// Length in ms of an RTTTL note of 1/n, dotted or not, the way the player
+// computes it.
+static long lengthOf(long wholenote, int n, bool dotted) {
+  long duration = wholenote / n;
+  return dotted ? duration + duration / 2 : duration;
+}
+
+struct Token {
+  int key;      // -1 for a pause
+  int volume;
+  int n;
+  bool dotted;
+};
+
+static void writeText(const std::vector<Segment> &segments, uint32_t usPerQuarter, const Options &options) {
+  static const int lengths[6] = { 1, 2, 4, 8, 16, 32 };
+  int bpm = (int)(60000000.0 / usPerQuarter + 0.5);
+  if (bpm < 1) bpm = 1;
+  long wholenote = (60 * 1000L / bpm) * 4;
+  std::vector<Token> tokens;
+  uint64_t origin = segments.empty() ? 0 : segments[0].start;
+  long written = 0; // ms of music written so far
+  int clamped = 0;
+
+  for (const Segment &segment : segments) {
+    int key = segment.key >= 0 ? segment.key + options.transpose : -1;
+    // RTTTL only has octaves 4 to 7
+    while (key >= 0 && key < 60) { key += 12; clamped++; }
+    while (key >= 108) { key -= 12; clamped++; }
+
+    // fill up to where this segment ends in real time, so rounding errors are
+    // made up for by the following notes
+    long end = (long)((segment.end - origin + 500) / 1000);
+    while (end - written > lengthOf(wholenote, 32, false) / 2) {
+      long want = end - written;
+      int bestN = 1;
+      bool bestDotted = false;
+      // longer stretches are split into whole notes plus the rest
+      if (want <= lengthOf(wholenote, 1, true)) {
+        long bestError = -1;
+        for (int i = 0; i < 6; i++) {
+          for (int dotted = 0; dotted < 2; dotted++) {
+            long length = lengthOf(wholenote, lengths[i], dotted);
+            long error = want > length ? want - length : length - want;
+            if (bestError < 0 || error < bestError) {
+              bestError = error;
+              bestN = lengths[i];
+              bestDotted = dotted;
+            }
+          }
+        }
+      }
+      Token token = { key, volumeOf(segment, options), bestN, bestDotted };
+      tokens.push_back(token);
+      written += lengthOf(wholenote, bestN, bestDotted);
+    }
+  }
+
+  // the most common length and octave become the defaults
+  int lengthUse[33] = {};
+  int octaveUse[8] = {};
+  for (const Token &token : tokens) {
+    lengthUse[token.n]++;
+    if (token.key >= 0) octaveUse[token.key / 12 - 1]++;
+  }
+  int defaultN = 4;
+  int defaultOctave = 5;
+  for (int i = 0; i < 6; i++) {
+    if (lengthUse[lengths[i]] > lengthUse[defaultN]) defaultN = lengths[i];
+  }
+  for (int o = 4; o <= 7; o++) {
+    if (octaveUse[o] > octaveUse[defaultOctave]) defaultOctave = o;
+  }
+
+  printf("%s:d=%d,o=%d,b=%d:", options.name.c_str(), defaultN, defaultOctave, bpm);
+  int volume = RTTTL_NOTE_VOLUME_MAX;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    const Token &token = tokens[i];
+    if (i > 0) printf(",");
+    if (token.key >= 0 && token.volume != volume) {
+      volume = token.volume;
+      printf("v%d,", volume);
+    }
+    if (token.n != defaultN) printf("%d", token.n);
+    if (token.key < 0) {
+      printf("p");
+    } else {
+      printf("%s", noteNames[token.key % 12]);
+      if (token.key / 12 - 1 != defaultOctave) printf("%d", token.key / 12 - 1);
+    }
+    if (token.dotted) printf(".");
+  }
+  printf("\n");
+
+  if (clamped > 0) {
+    fprintf(stderr, "midi2rtttl: moved %d notes by octaves into the RTTTL range, try -t\n", clamped);
+  }
+}
+
+static void usage() {
+  fprintf(stderr, "usage: midi2rtttl [-c channel] [-l] [-t semitones] [-q 1/N] [-v] [-a] [-n name] file.mid\n");
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  const char *path = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+      options.channel = atoi(argv[++i]) - 1;
+    } else if (!strcmp(argv[i], "-l")) {
+      options.lowest = true;
+    } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+      options.transpose = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-q") && i + 1 < argc) {
+      options.quantize = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-v")) {
+      options.velocity = true;
+    } else if (!strcmp(argv[i], "-a")) {
+      options.array = true;
+    } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      options.name = argv[++i];
+    } else if (argv[i][0] != '-' && path == nullptr) {
+      path = argv[i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (path == nullptr) {
+    usage();
+    return 2;
+  }
+
+  if (options.name.empty()) {
+    // file name without directory and extension, usable as an identifier
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    for (const char *c = base; *c && *c != '.'; c++) {
+      bool word = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9');
+      options.name += word ? *c : '_';
+    }
+    if (options.name.empty() || (options.name[0] >= '0' && options.name[0] <= '9')) {
+      options.name = "song" + options.name;
+    }
+  }
+
+  FILE *f = fopen(path, "rb");
+  if (f == nullptr) {
+    fprintf(stderr, "midi2rtttl: cannot open %s\n", path);
+    return 1;
+  }
+  std::vector<uint8_t> file;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    file.insert(file.end(), chunk, chunk + n);
+  }
+  fclose(f);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Midi midi;
+  if (!readMidi(file, midi)) {
+    fprintf(stderr, "midi2rtttl: %s is not a valid MIDI file\n", path);
+    return 1;
+  }
+  std::vector<Segment> segments = reduce(midi, options);
+
+  if (options.array) {
+    writeArray(segments, options);
+  } else {
+    writeText(segments, midi.tempos.empty() ? 500000 : midi.tempos[0].usPerQuarter, options);
+  }
+
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  fprintf(stderr, "midi2rtttl: %zu MIDI events, %zu notes and pauses in %.1f ms\n",
+          midi.events.size(), segments.size(), ms);
+  return 0;
+}
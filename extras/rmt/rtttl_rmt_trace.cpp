@@ -0,0 +1,143 @@
+/*
+ * Renders the RMT symbols the RMT output would play for a song and checks
+ * them against the song: note starts, pitch and total length. Optionally
+ * writes the waveform as a VCD file for a waveform viewer.
+ *
+ * Build with:
+ *   cmake -S . -B build && cmake --build build --target rtttl_rmt_trace
+ *
+ * Usage:
+ *   rtttl_rmt_trace [-r ticks/s] [-w file.vcd] [-n] ["rtttl song"]
+ *     -r N   RMT resolution, default RTTTL_RMT_RESOLUTION
+ *     -w F   write the waveform to F
+ *     -n     print every note
+ */
+
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "RTTTLRmtEncoder.h"
+
+// what RTTTLRmt stages per refill, so the block boundaries match the hardware
+static const size_t refillSymbols = RTTTL_RMT_BLOCK_SYMBOLS;
+
+int main(int argc, char **argv) {
+  uint32_t resolution = RTTTL_RMT_RESOLUTION;
+  const char *vcdPath = nullptr;
+  const char *song = "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#,8c#6,8b,d,e,8b,8a,c#,e,2a";
+  bool verbose = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+      resolution = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+      vcdPath = argv[++i];
+    } else if (!strcmp(argv[i], "-n")) {
+      verbose = true;
+    } else if (argv[i][0] != '-') {
+      song = argv[i];
+    } else {
+      fprintf(stderr, "usage: rtttl_rmt_trace [-r ticks/s] [-w file.vcd] [-n] [\"rtttl song\"]\n");
+      return 2;
+    }
+  }
+
+  RTTTLRmtEncoder encoder(resolution);
+  if (!encoder.song().load(song)) {
+    fprintf(stderr, "rtttl_rmt_trace: not an RTTTL song\n");
+    return 1;
+  }
+
+  // encode the way the RMT interrupt does, a refill at a time
+  std::vector<uint32_t> symbols;
+  uint32_t chunk[refillSymbols];
+  size_t refills = 0;
+  size_t n;
+  encoder.start();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  while ((n = encoder.encode(chunk, refillSymbols)) > 0) {
+    symbols.insert(symbols.end(), chunk, chunk + n);
+    refills++;
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  // rising edge times of the waveform
+  std::vector<uint64_t> rises;
+  uint64_t time = 0;
+  bool level = false;
+  FILE *vcd = vcdPath ? fopen(vcdPath, "w") : nullptr;
+  if (vcd) {
+    fprintf(vcd, "$timescale %u ns $end\n$scope module rtttl $end\n$var wire 1 ! out $end\n$upscope $end\n"
+                 "$enddefinitions $end\n#0\n0!\n", 1000000000u / resolution);
+  }
+  for (uint32_t symbol : symbols) {
+    for (int half = 0; half < 2; half++) {
+      uint32_t duration = (symbol >> (16 * half)) & 0x7FFF;
+      bool high = (symbol >> (16 * half + 15)) & 1;
+      if (duration == 0) {
+        fprintf(stderr, "rtttl_rmt_trace: zero duration would end the transmission early\n");
+        return 1;
+      }
+      if (high != level) {
+        if (high) rises.push_back(time);
+        if (vcd) fprintf(vcd, "#%llu\n%d!\n", (unsigned long long)time, high);
+        level = high;
+      }
+      time += duration;
+    }
+  }
+  if (vcd) {
+    fprintf(vcd, "#%llu\n", (unsigned long long)time);
+    fclose(vcd);
+  }
+
+  // compare every note against the song
+  RTTTLSequencer sequencer;
+  RTTTLNote note;
+  sequencer.load(song);
+  sequencer.start(0);
+  uint64_t songMs = 0;
+  size_t rise = 0;
+  size_t notes = 0;
+  double worstCents = 0;
+  double worstStart = 0;
+  while (sequencer.nextNote(note)) {
+    uint64_t from = songMs * resolution / 1000;
+    songMs += note.duration;
+    uint64_t to = songMs * resolution / 1000;
+    notes++;
+
+    size_t first = rise;
+    while (rise < rises.size() && rises[rise] < to) rise++;
+    size_t edges = rise - first;
+    if (note.frequency == 0 || edges < 2) {
+      if (verbose) printf("  %3zu  pause %6llu ms\n", notes - 1, (unsigned long long)note.duration);
+      continue;
+    }
+
+    double measured = (edges - 1) * (double)resolution / (rises[rise - 1] - rises[first]);
+    double cents = 1200 * log2(measured / note.frequency);
+    double late = (double)(rises[first] - from) * 1e6 / resolution;
+    worstCents = fmax(worstCents, fabs(cents));
+    worstStart = fmax(worstStart, late);
+    if (verbose) {
+      printf("  %3zu  %5u Hz %6llu ms  measured %9.3f Hz (%+.3f cents), starts %+.1f us\n", notes - 1,
+             note.frequency, (unsigned long long)note.duration, measured, cents, late);
+    }
+  }
+
+  uint64_t expected = songMs * resolution / 1000;
+  printf("%zu notes, %zu symbols (%zu bytes), %zu refills of %zu symbols, %.1f ns/symbol\n", notes,
+         symbols.size(), symbols.size() * sizeof(uint32_t), refills, refillSymbols, ns / symbols.size());
+  printf("worst pitch error %.3f cents, worst note start %.1f us, length %llu ticks for %llu expected\n",
+         worstCents, worstStart, (unsigned long long)time, (unsigned long long)expected);
+
+  // a note edge more than one tick off or a length drifting means a bug
+  bool ok = time >= expected && time <= expected + 2 && worstStart * resolution / 1e6 <= 1.0;
+  return ok ? 0 : 1;
+}
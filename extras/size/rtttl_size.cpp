@@ -0,0 +1,140 @@
+/*
+ * Reports the memory the platform independent parts of the RTTTL player take:
+ * RAM per instance of every class, bytes per compiled note and the stack
+ * used while a worst-case song is parsed, scheduled and encoded.
+ *
+ * Build and run with:
+ *   cmake -S . -B build && cmake --build build --target size
+ *
+ * The size target also lists the code size of every source file of the
+ * library, one file per feature. These are host numbers for the portable
+ * sources only; RTTTL itself, the outputs and the LEDC pool need ESP-IDF and
+ * are covered by idf.py size-components and size-files and by the budgets in
+ * RTTTL.h, see the README.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "RTTTLCommandQueue.h"
+#include "RTTTLEffects.h"
+#include "RTTTLJitter.h"
+#include "RTTTLMML.h"
+#include "RTTTLNokia.h"
+#include "RTTTLParser.h"
+#include "RTTTLPitch.h"
+#include "RTTTLProgress.h"
+#include "RTTTLRmtEncoder.h"
+#include "RTTTLSequencer.h"
+#include "RTTTLVoice.h"
+
+// Exercises every RTX extension: header keys in any order, loops, style and
+// volume changes, dotted notes on both sides of the octave.
+static const char *worstCase =
+  "Worst case:b=160,l=2,s=N,v=12,d=4,o=4:8c5,8c5,sS,8c5,8c5,2b,8f#,a,v8,2g,8c5,c5,b,8a,8b,8a,g,e5,sC,2a,b.,8p,"
+  "8c5,8b,8a,c5,8b,8a,d5,v15,8c5,8b,d5,8c5,8b,e5,8d5,8e5,f#5,b,1g5,8p,8g5,8e5,8c5,8f#5,8d5,8b,8e5,8c5,8a,"
+  "8d5,8b,8g,c5,b,8c5,8b,8a,8g,a#,a,8g.,32c#7.,32d#7";
+static const char *worstCaseMML = "t180 l16 o4 v12 q90 c+d-e&e8 f+g>a+b<c d8.&d32 r8 n60 n72 >>c<<c";
+
+// Stack the measured work runs on, painted so the untouched part shows.
+static const size_t stackSize = 64 * 1024;
+static const uint8_t paint = 0xA5;
+static uint8_t stack[stackSize] __attribute__((aligned(64)));
+static volatile uint32_t sink;
+
+// kept off the measured stack, which should only show the library
+static RTTTLNote notes[256];
+static RTTTLSequencer sequencer;
+static RTTTLMMLParser mml;
+static RTTTLRmtEncoder encoder;
+
+static void *playWorstCase(void *arg) {
+  RTTTLSong song;
+  RTTTLNote note;
+  uint32_t symbols[32];
+  uint32_t sum = 0;
+  (void)arg;
+
+  // every path a note takes on its way to the output
+  RTTTLParser::compile(worstCase, notes, sizeof(notes) / sizeof(notes[0]), song);
+  sequencer.load(worstCase);
+  sequencer.start(0);
+  while (sequencer.nextNote(note)) sum += note.frequency;
+  sequencer.load(worstCaseMML, &mml);
+  sequencer.start(0);
+  while (sequencer.nextNote(note)) sum += note.frequency;
+  encoder.song().load(song);
+  encoder.start();
+  size_t n;
+  while ((n = encoder.encode(symbols, 32)) > 0) sum += symbols[n - 1];
+  sink = sum;
+  return nullptr;
+}
+
+static void *idle(void *arg) {
+  return arg;
+}
+
+static size_t stackUsed(void *(*work)(void *)) {
+  pthread_attr_t attr;
+  pthread_t thread;
+
+  memset(stack, paint, stackSize);
+  pthread_attr_init(&attr);
+  if (pthread_attr_setstack(&attr, stack, stackSize) != 0 ||
+      pthread_create(&thread, &attr, work, nullptr) != 0) {
+    return 0;
+  }
+  pthread_join(thread, nullptr);
+  pthread_attr_destroy(&attr);
+
+  // the stack grows down, so the lowest touched byte marks the deepest call
+  size_t untouched = 0;
+  while (untouched < stackSize && stack[untouched] == paint) untouched++;
+  return stackSize - untouched;
+}
+
+#define ROW(type, note) printf("  %-22s %6zu  %s\n", #type, sizeof(type), note)
+
+int main() {
+  printf("host build, %zu bit pointers; the ESP32 has 32 bit pointers and packs tighter\n\n",
+         sizeof(void *) * 8);
+  printf("RAM per instance (bytes, host):\n");
+  ROW(RTTTLParser, "RTTTL/RTX front-end, one per player");
+  ROW(RTTTLMMLParser, "optional front-end");
+  ROW(RTTTLNokiaParser, "optional front-end");
+  ROW(RTTTLSequencer, "song position and tempo, holds an RTTTLParser");
+  ROW(RTTTLCommandQueue, "control calls waiting for the engine");
+  ROW(RTTTLCommand, "one queued control call");
+  ROW(RTTTLPitch, "LEDC timer settings of a song");
+  ROW(RTTTLEnvelope, "");
+  ROW(RTTTLSweep, "glide, one per player");
+  ROW(RTTTLLfo, "vibrato and tremolo, two per player");
+  ROW(RTTTLProgress, "position() snapshot");
+  ROW(RTTTLVoice, "sequencer, glide, LFOs and position, one per player");
+  ROW(RTTTLJitter, "only with RTTTL_JITTER_STATS");
+  ROW(RTTTLRmtEncoder, "RMT output");
+
+  RTTTLSong song;
+  RTTTLParser::compile(worstCase, notes, sizeof(notes) / sizeof(notes[0]), song);
+  printf("\ncompiled songs: %zu bytes per note, %zu per RTTTLSong; worst case song %zu notes = %zu bytes "
+         "(text %zu bytes)\n", sizeof(RTTTLNote), sizeof(RTTTLSong), song.count, song.count * sizeof(RTTTLNote),
+         strlen(worstCase) + 1);
+
+  // the thread library keeps its own data at the top of the stack, an empty
+  // thread shows how much
+  size_t base = stackUsed(idle);
+  size_t used = stackUsed(playWorstCase);
+  if (base == 0 || used < base) {
+    fprintf(stderr, "rtttl_size: could not run on a measured stack\n");
+    return 1;
+  }
+  printf("stack for parsing, scheduling and encoding the worst case song: %zu bytes (host)\n", used - base);
+  printf("\nnot covered here: RTTTL and RTTTLLedcOutput (checked against RTTTL_RAM_BUDGET and\n"
+         "RTTTL_LEDC_RAM_BUDGET when built for the ESP32), the other outputs and the playback task\n"
+         "stack; run idf.py size-components or size-files and read stackHighWaterMark() after the\n"
+         "worst case song\n");
+  return 0;
+}
@@ -4,223 +4,652 @@
  */
 
 #include "RTTTL.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 
-static TaskHandle_t rtttlTaskHandle;
+#include <new>
+
+// the command queue and the jitter record are sized by their own options, so
+// only the rest of the player is held to the budget
+#if RTTTL_JITTER_STATS
+static const size_t jitterRam = sizeof(RTTTLJitter) + sizeof(portMUX_TYPE);
+#else
+static const size_t jitterRam = 0;
+#endif
+static_assert(sizeof(RTTTL) - sizeof(RTTTLCommandQueue) - jitterRam <= RTTTL_RAM_BUDGET,
+              "RTTTL grew past RTTTL_RAM_BUDGET");
+static_assert(sizeof(RTTTLLedcOutput) <= RTTTL_LEDC_RAM_BUDGET, "RTTTLLedcOutput grew past RTTTL_LEDC_RAM_BUDGET");
 
 void rtttlTask(void *param) {
   RTTTL *rtttl = (RTTTL*)param;
 
   while(true) {
-    xTaskNotifyWait(pdFALSE, ULONG_MAX, nullptr, portMAX_DELAY);
-    while (rtttl->isPlaying()) {
-      rtttl->continuePlaying();
+    rtttl->processCommands();
+    if (rtttl->continuePlaying()) {
+      rtttl->wakeAtNextNote();
     }
+    // sleep until the wake up timer fires or send() brings a control call
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+void rtttlWake(void *param) {
+  TaskHandle_t task = ((RTTTL*)param)->task;
+  if (task != nullptr) {
+    xTaskNotifyGive(task);
   }
 }
 
-RTTTL::RTTTL(const gpio_num_t pin, const ledc_channel_t channel, const ledc_timer_t timer) {
+RTTTL::RTTTL(const gpio_num_t pin, const ledc_channel_t channel, const ledc_timer_t timer,
+             const RTTTLConfig &config) {
   this->pin = pin;
   this->channel = channel;
   this->timer = timer;
+  this->config = config;
+}
 
-  ledc_timer_config_t ledc_timer = {
-      .speed_mode       = LEDC_LOW_SPEED_MODE,
-      .duty_resolution  = LEDC_TIMER_10_BIT,
-      .timer_num        = timer,
-      .freq_hz          = 2093,
-      .clk_cfg          = LEDC_AUTO_CLK
-  };
-  ledc_timer_config(&ledc_timer);
-
-  ledc_channel_config_t ledc_channel = {
-      .gpio_num       = pin,
-      .speed_mode     = LEDC_LOW_SPEED_MODE,
-      .channel        = channel,
-      .intr_type      = LEDC_INTR_DISABLE,
-      .timer_sel      = timer,
-      .duty           = 0,
-      .hpoint         = 0,
-      .flags          = {0}
-  };
-  ledc_channel_config(&ledc_channel);
-
-  xTaskCreatePinnedToCore(rtttlTask, "rtttlTask", 4096, this, 1, &rtttlTaskHandle, 1);
-}
-
-void RTTTL::loadSong(const char *song) {
-  loadSong(song, 10);
-}
-
-void RTTTL::loadSong(const char *song, const int volume) {
-  buffer = song;
-  defaultDur = 4;
-  defaultOct = 6;
-  bpm = 63;
-  noteDelay = 0;
-  this->volume = volume;
-
-  // stop current note
-  noTone();
+RTTTL::RTTTL(RTTTLOutput &output, const RTTTLConfig &config) {
+  this->output = &output;
+  this->config = config;
+}
 
-  int num;
+RTTTL::~RTTTL() {
+  end();
+  delete ledc;
+}
+
+bool RTTTL::begin() {
+  bool expected = false;
 
-  // format: d=N,o=N,b=NNN:
-  while (*buffer != ':') buffer++; // ignore name
-  buffer++; // skip ':'
+  if (task != nullptr) {
+    return true;
+  }
+  // the first play() can come from several tasks at once, only one of them
+  // sets the player up and the others wait for it
+  if (!starting.compare_exchange_strong(expected, true)) {
+    while (starting) {
+      vTaskDelay(1);
+    }
+    return task != nullptr;
+  }
+  bool started = task != nullptr || setUp();
+  starting = false;
+  return started;
+}
 
-  // get default duration
-  if (*buffer == 'd') {
-    buffer++; buffer++; // skip "d="
-    num = 0;
-    while (isdigit(*buffer)) {
-      num = (num * 10) + (*buffer++ - '0');
+bool RTTTL::setUp() {
+  if (output == nullptr) {
+    ledc = new (std::nothrow) RTTTLLedcOutput(pin, channel, timer);
+    if (ledc == nullptr) {
+      return false;
     }
-    if (num > 0) defaultDur = num;
-    buffer++; // skip comma
+    output = ledc;
+  }
+  if (!output->begin()) {
+    return false;
+  }
+
+#if CONFIG_PM_ENABLE
+  if (esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "rtttl", &apbLock) != ESP_OK ||
+      esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "rtttl", &sleepLock) != ESP_OK) {
+    tearDown();
+    return false;
+  }
+#endif
+
+  if (doneGroup == nullptr) {
+    doneGroup = xEventGroupCreateStatic(&doneGroupBuffer);
+  }
+  xEventGroupClearBits(doneGroup, ENDED_BIT);
+  xEventGroupSetBits(doneGroup, DONE_BIT);
+
+  // everything the task uses exists before it runs
+  voice.setEffectRate(config.effectRate);
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = rtttlWake;
+  timerArgs.arg = this;
+  timerArgs.dispatch_method = ESP_TIMER_TASK;
+  timerArgs.name = "rtttl";
+  if (esp_timer_create(&timerArgs, &wakeTimer) != ESP_OK) {
+    wakeTimer = nullptr;
+    tearDown();
+    return false;
+  }
+
+  TaskHandle_t handle = nullptr;
+  if (config.stack != nullptr && config.taskBuffer != nullptr) {
+    handle = xTaskCreateStaticPinnedToCore(rtttlTask, "rtttlTask", config.stackSize, this, config.priority,
+                                           config.stack, config.taskBuffer, config.core);
+  } else if (xTaskCreatePinnedToCore(rtttlTask, "rtttlTask", config.stackSize, this, config.priority,
+                                     &handle, config.core) != pdPASS) {
+    handle = nullptr;
+  }
+  if (handle == nullptr) {
+    tearDown();
+    return false;
+  }
+
+  // the task may have looked at the queue before the handle was published,
+  // wake it once for commands queued in between
+  task = handle;
+  xTaskNotifyGive(handle);
+  return true;
+}
+
+void RTTTL::end() {
+  if (task == nullptr) {
+    return;
+  }
+
+  // let the engine finish what it is doing and park itself before deleting it
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_END;
+  while (!send(command)) {
+    vTaskDelay(1);
+  }
+  xEventGroupWaitBits(doneGroup, ENDED_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+  esp_timer_stop(wakeTimer);
+  vTaskDelete(task);
+  task = nullptr;
+
+  // the engine is gone, so whatever was queued behind END would only replay
+  // after the next begin(); drop it along with the plays it was counting
+  RTTTLCommand stale;
+  while (commands.pop(stale)) {
+  }
+  pendingPlays = 0;
+  stopRequested = false;
+  xEventGroupSetBits(doneGroup, DONE_BIT);
+
+  tearDown();
+}
+
+// Frees what setUp() made, in reverse, whether it got all the way or not.
+void RTTTL::tearDown() {
+  if (wakeTimer != nullptr) {
+    esp_timer_delete(wakeTimer);
+    wakeTimer = nullptr;
+  }
+
+#if CONFIG_PM_ENABLE
+  if (apbLock != nullptr) {
+    esp_pm_lock_delete(apbLock);
+  }
+  if (sleepLock != nullptr) {
+    esp_pm_lock_delete(sleepLock);
   }
+  apbLock = sleepLock = nullptr;
+#endif
 
-  // get default octave
-  if (*buffer == 'o') {
-    buffer++; buffer++; // skip "o="
-    num = *buffer++ - '0';
-    if(num >= 3 && num <=7) defaultOct = num;
-    buffer++; // skip comma
+  output->end();
+}
+
+bool RTTTL::loadSong(const char *song) {
+  return loadSong(song, 10);
+}
+
+bool RTTTL::loadSong(const char *song, const int volume) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_LOAD_TEXT;
+  command.value = volume;
+  command.text = song;
+  if (!send(command)) {
+    return false;
+  }
+  songLoaded = song != nullptr;
+  return true;
+}
+
+bool RTTTL::loadSong(const char *song, RTTTLFrontEnd &format, const int volume) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_LOAD_TEXT;
+  command.value = volume;
+  command.text = song;
+  command.format = &format;
+  if (!send(command)) {
+    return false;
   }
+  songLoaded = song != nullptr;
+  return true;
+}
+
+bool RTTTL::loadSong(const RTTTLSong &song) {
+  return loadSong(song, 10);
+}
 
-  // get BPM
-  if(*buffer == 'b') {
-    buffer++; buffer++; // skip "b="
-    num = 0;
-    while(isdigit(*buffer)) {
-      num = (num * 10) + (*buffer++ - '0');
+bool RTTTL::loadSong(const RTTTLSong &song, const int volume) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_LOAD_SONG;
+  command.value = volume;
+  command.song = song;
+  if (!send(command)) {
+    return false;
+  }
+  songLoaded = song.notes != nullptr;
+  return true;
+}
+
+bool RTTTL::send(const RTTTLCommand &command) {
+  if (!commands.push(command)) {
+    return false;
+  }
+  // before begin() the command waits in the queue
+  TaskHandle_t handle = task;
+  if (handle != nullptr) {
+    xTaskNotifyGive(handle);
+  }
+  return true;
+}
+
+bool IRAM_ATTR RTTTL::sendFromISR(const RTTTLCommand &command) {
+  BaseType_t woken = pdFALSE;
+  TaskHandle_t handle = task;
+
+  // nothing would ever take the command before begin() or after end()
+  if (handle == nullptr || !commands.push(command)) {
+    return false;
+  }
+  vTaskNotifyGiveFromISR(handle, &woken);
+  portYIELD_FROM_ISR(woken);
+  return true;
+}
+
+void RTTTL::processCommands() {
+  RTTTLCommand command;
+
+  while (commands.pop(command)) {
+    switch (command.type) {
+      case RTTTL_COMMAND_LOAD_TEXT:
+      case RTTTL_COMMAND_LOAD_SONG:
+      case RTTTL_COMMAND_PLAY_SONG:
+        if (command.value >= 0) {
+          volume = command.value;
+        }
+        // stop current note
+        endNote();
+        if (command.type == RTTTL_COMMAND_LOAD_TEXT) {
+          voice.load(command.text, command.format);
+        } else {
+          voice.load(command.song);
+        }
+        voice.plan(*output);
+        if (command.type == RTTTL_COMMAND_PLAY_SONG) {
+          startSong();
+        }
+        break;
+      case RTTTL_COMMAND_PLAY:
+        startSong();
+        break;
+      case RTTTL_COMMAND_STOP:
+        halt(false);
+        break;
+      case RTTTL_COMMAND_VOLUME:
+        volume = command.value;
+        break;
+      case RTTTL_COMMAND_TEMPO:
+        voice.song().setTempo(command.value);
+        break;
+      case RTTTL_COMMAND_ENVELOPE:
+        envelope = command.envelope;
+        break;
+      case RTTTL_COMMAND_PORTAMENTO:
+        voice.setPortamento(command.value, command.curve);
+        break;
+      case RTTTL_COMMAND_SWEEP:
+        endNote();
+        voice.sweep(command.from, command.to, command.duration, command.curve, esp_timer_get_time());
+        if (!playing) {
+          playing = true;
+          xEventGroupClearBits(doneGroup, DONE_BIT);
+        }
+        pendingPlays--;
+        break;
+      case RTTTL_COMMAND_VIBRATO:
+        voice.setVibrato(command.rate, command.value);
+        break;
+      case RTTTL_COMMAND_TREMOLO:
+        voice.setTremolo(command.rate, command.value);
+        break;
+      case RTTTL_COMMAND_NOTE_ON:
+        noteOnCallback = (RTTTLNoteCallback)command.callback;
+        noteOnArg = command.arg;
+        break;
+      case RTTTL_COMMAND_NOTE_OFF:
+        noteOffCallback = (RTTTLNoteCallback)command.callback;
+        noteOffArg = command.arg;
+        break;
+      case RTTTL_COMMAND_SONG_END:
+        songEndCallback = (RTTTLSongEndCallback)command.callback;
+        songEndArg = command.arg;
+        break;
+      case RTTTL_COMMAND_DONE_QUEUE:
+        doneQueue = (QueueHandle_t)command.handle;
+        break;
+      case RTTTL_COMMAND_DONE_EVENTS:
+        doneEvents = (EventGroupHandle_t)command.handle;
+        doneEventBits = (EventBits_t)command.value;
+        break;
+      case RTTTL_COMMAND_JITTER_RESET:
+#if RTTTL_JITTER_STATS
+        portENTER_CRITICAL(&jitterLock);
+        jitterStats.reset();
+        portEXIT_CRITICAL(&jitterLock);
+#endif
+        break;
+      case RTTTL_COMMAND_END:
+        halt(false);
+        noTone();
+        xEventGroupSetBits(doneGroup, ENDED_BIT);
+        // end() deletes the task from here
+        vTaskSuspend(nullptr);
+        break;
     }
-    bpm = num;
-    buffer++; // skip colon
   }
+  if (stopRequested.exchange(false)) {
+    halt(false);
+  }
+}
 
-  // BPM = number of quarter notes per minute
-  wholenote = (60 * 1000L / bpm) * 2;  // this is the time for whole note (in milliseconds)
-  songStart = buffer;
+void RTTTL::startSong() {
+  if (!playing && voice.song().isLoaded()) {
+    voice.start(esp_timer_get_time());
+    playing = true;
+    xEventGroupClearBits(doneGroup, DONE_BIT);
+  }
+  pendingPlays--;
+  // queuePlay() cleared the bit, give it back if nothing started
+  if (!playing) {
+    xEventGroupSetBits(doneGroup, DONE_BIT);
+  }
+}
+
+void RTTTL::wakeAtNextNote() {
+  int64_t deadline = voice.nextDeadline(sounding);
+  if (envelopeStage != ENVELOPE_IDLE && envelopeDeadline < deadline) {
+    deadline = envelopeDeadline;
+  }
+  if (sounding && noteEnd < deadline) {
+    deadline = noteEnd;
+  }
+
+  int64_t wait = deadline - esp_timer_get_time();
+  if (wait <= 0) {
+    xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+    return;
+  }
+  // a one shot timer wakes the task to the microsecond while letting the
+  // chip sleep in between, unlike a tick based timeout
+  esp_timer_stop(wakeTimer);
+  esp_timer_start_once(wakeTimer, wait);
+}
+
+void RTTTL::holdPower(bool hold) {
+#if CONFIG_PM_ENABLE
+  // keep APB at full speed and stay out of light sleep only while LEDC is
+  // actually producing a tone
+  if (hold == powerHeld) {
+    return;
+  }
+  powerHeld = hold;
+  if (hold) {
+    esp_pm_lock_acquire(apbLock);
+    esp_pm_lock_acquire(sleepLock);
+  } else {
+    esp_pm_lock_release(sleepLock);
+    esp_pm_lock_release(apbLock);
+  }
+#else
+  (void)hold;
+#endif
 }
 
 void RTTTL::noTone() {
-    ledc_set_duty(LEDC_LOW_SPEED_MODE, channel, 0);
-    ledc_update_duty(LEDC_LOW_SPEED_MODE, channel);
+  envelopeStage = ENVELOPE_IDLE;
+  voice.stopGlide();
+  setDuty(0);
+}
+
+void RTTTL::setDuty(uint32_t duty) {
+  fading = false;
+  level = duty;
+  output->setDuty(duty);
 }
 
-void RTTTL::tone(uint32_t freq, uint32_t duration) {
-  ledc_timer_config_t ledc_timer = {
-      .speed_mode       = LEDC_LOW_SPEED_MODE,
-      .duty_resolution  = LEDC_TIMER_10_BIT,
-      .timer_num        = this->timer,
-      .freq_hz          = freq,
-      .clk_cfg          = LEDC_AUTO_CLK
-  };
-  ledc_timer_config(&ledc_timer);
+void RTTTL::fade(uint32_t duty, uint32_t ms) {
+  if (ms == 0 || !output->fade(duty, ms)) {
+    setDuty(duty);
+    return;
+  }
+  fading = true;
+  fadeEnd = esp_timer_get_time() + ms * 1000LL;
+  level = duty;
+}
 
-  ledc_set_duty(LEDC_LOW_SPEED_MODE, channel, 512);
-  ledc_update_duty(LEDC_LOW_SPEED_MODE, channel);
+void RTTTL::startEnvelope(int64_t start, uint32_t length) {
+  uint32_t peak = duty();
 
-  vTaskDelay(pdMS_TO_TICKS(duration));
-  // If play was stopped while task delayed make sure the tone stops.
-  if (!playing) {
-    noTone();
+  if (!envelope.enabled()) {
+    setDuty(peak);
+    return;
+  }
+
+  attackTime = envelope.attack < length ? envelope.attack : length;
+  length -= attackTime;
+  releaseTime = envelope.release < length ? envelope.release : length;
+  length -= releaseTime;
+  decayTime = envelope.decay < length ? envelope.decay : length;
+
+  envelopeStage = ENVELOPE_ATTACK;
+  envelopeDeadline = start + attackTime * 1000LL;
+  if (attackTime > 0) {
+    setDuty(0);
+    fade(peak, attackTime);
+  } else {
+    setDuty(peak);
+  }
+  // skip over stages that have no time
+  stepEnvelope();
+}
+
+void RTTTL::stepEnvelope() {
+  int64_t now = esp_timer_get_time();
+
+  while (envelopeStage != ENVELOPE_IDLE && now >= envelopeDeadline) {
+    switch (envelopeStage) {
+      case ENVELOPE_ATTACK:
+        if (envelope.sustain < 100) {
+          fade(duty() * envelope.sustain / 100, decayTime);
+        }
+        envelopeStage = ENVELOPE_DECAY;
+        envelopeDeadline += decayTime * 1000LL;
+        break;
+      case ENVELOPE_DECAY:
+        envelopeStage = ENVELOPE_SUSTAIN;
+        envelopeDeadline = noteEnd - releaseTime * 1000LL;
+        if (releaseTime == 0) {
+          // hold the level until the next note
+          envelopeStage = ENVELOPE_IDLE;
+        }
+        break;
+      case ENVELOPE_SUSTAIN:
+        fade(0, releaseTime);
+        envelopeStage = ENVELOPE_IDLE;
+        break;
+      default:
+        envelopeStage = ENVELOPE_IDLE;
+        break;
+    }
+  }
+}
+
+bool RTTTL::stepGlide() {
+  uint16_t frequency;
+  if (!voice.stepGlide(esp_timer_get_time(), frequency)) {
+    return false;
+  }
+  baseFrequency = frequency;
+  return true;
+}
+
+bool RTTTL::stepLfo() {
+  int64_t now = esp_timer_get_time();
+  if (!sounding || voice.stepLfo(now) == 0) {
+    return false;
   }
+
+  const RTTTLLfo &tremolo = voice.tremolo();
+  if (tremolo.enabled()) {
+    // the fade hardware owns the duty until its ramp is over
+    if (!fading || now >= fadeEnd) {
+      fading = false;
+      // swings between level and level * (1 - depth)
+      int32_t gain = 65536 - tremolo.range() - tremolo.value();
+      output->setDuty((uint32_t)(((uint64_t)level * gain) >> 16));
+    }
+  }
+  return voice.vibrato().enabled();
+}
+
+void RTTTL::writeFrequency() {
+  uint32_t freq = baseFrequency;
+  if (!tuned) {
+    return;
+  }
+  const RTTTLLfo &vibrato = voice.vibrato();
+  if (vibrato.enabled()) {
+    freq += ((int64_t)freq * vibrato.value()) >> 16;
+  }
+  output->retune(freq);
 }
 
+void RTTTL::tone(uint32_t freq) {
+  baseFrequency = freq;
+  tuned = output->tone(freq);
+}
+
+uint32_t RTTTL::duty() {
+  // half of the period is the loudest a piezo gets
+  uint32_t half = tuned ? output->fullScale() / 2 : 0;
+  int level = volume;
+  if (level < 0) level = 0;
+  if (level > RTTTL_MAX_VOLUME) level = RTTTL_MAX_VOLUME;
+  // RTX note volumes scale the player volume
+  return (uint64_t)half * level * (RTTTL_NOTE_VOLUME_MAX - noteAttenuation) / (RTTTL_MAX_VOLUME * RTTTL_NOTE_VOLUME_MAX);
+}
 
-void RTTTL::nextNote() {
-  long duration;
-  uint8_t note;
-  uint8_t scale;
+bool RTTTL::nextNote() {
+  RTTTLVoiceNote step;
+
+  if (!voice.next(step)) {
+    return false;
+  }
+  const RTTTLNote &note = step.note;
 
   //stop current note
+  endNote();
+
+  // consecutive notes keep the lock so APB is not switched between them
+  holdPower(note.frequency != 0);
+  if (note.frequency) {
+    noteEnd = step.scheduled + step.length * 1000LL;
+    noteAttenuation = note.attenuation < RTTTL_NOTE_VOLUME_MAX ? note.attenuation : RTTTL_NOTE_VOLUME_MAX;
+    voice.startNote(step);
+
+    if (step.from) {
+      // the lower end needs the most duty bits, plan the whole glide for it
+      tone(step.from < note.frequency ? step.from : note.frequency);
+      baseFrequency = step.from;
+      writeFrequency();
+    } else {
+      tone(note.frequency);
+    }
+    startEnvelope(step.scheduled, step.length);
+    current.index = step.index;
+    current.frequency = note.frequency;
+    current.duration = note.duration;
+    sounding = true;
+  }
+
+#if RTTTL_JITTER_STATS
+  int64_t actual = RTTTLJitter::now();
+  portENTER_CRITICAL(&jitterLock);
+  jitterStats.record(step.scheduled, actual);
+  portEXIT_CRITICAL(&jitterLock);
+#endif
+
+  if (sounding && noteOnCallback) {
+    noteOnCallback(current, noteOnArg);
+  }
+  return true;
+}
+
+void RTTTL::endNote() {
   noTone();
+  output->release();
+  if (sounding) {
+    sounding = false;
+    if (noteOffCallback) {
+      noteOffCallback(current, noteOffArg);
+    }
+  }
+}
 
-  // first, get note duration, if available
-  int num = 0;
-  while (isdigit(*buffer)) {
-    num = (num * 10) + (*buffer++ - '0');
-  }
-
-  if (num) duration = wholenote / num;
-  else duration = wholenote / defaultDur;  // we will need to check if we are a dotted note after
-
-  // now get the note
-  note = 0;
-
-  switch(*buffer) {
-    case 'c':
-      note = 1;
-      break;
-    case 'd':
-      note = 3;
-      break;
-    case 'e':
-      note = 5;
-      break;
-    case 'f':
-      note = 6;
-      break;
-    case 'g':
-      note = 8;
-      break;
-    case 'a':
-      note = 10;
-      break;
-    case 'b':
-      note = 12;
-      break;
-    case 'p':
-    default:
-      note = 0;
-  }
-  buffer++;
-
-  // now, get optional '#' sharp
-  if (*buffer == '#') {
-    note++;
-    buffer++;
-  }
-
-  // now, get optional '.' dotted note
-  if (*buffer == '.') {
-    duration += duration/2;
-    buffer++;
-  }
-
-  // now, get scale
-  if (isdigit(*buffer)) {
-    scale = *buffer - '0';
-    buffer++;
-  } else {
-    scale = defaultOct;
+// Clears the done bit before the command is on its way, so waitUntilDone()
+// does not wake on the previous song. The engine sets it again when the
+// song ends or when nothing starts.
+bool RTTTL::queuePlay(const RTTTLCommand &command) {
+  pendingPlays++;
+  xEventGroupClearBits(doneGroup, DONE_BIT);
+  if (!send(command)) {
+    pendingPlays--;
+    if (!isPlaying()) {
+      xEventGroupSetBits(doneGroup, DONE_BIT);
+    }
+    return false;
   }
+  return true;
+}
 
-  scale += OCTAVE_OFFSET;
+bool RTTTL::play() {
+  if (!songLoaded || !begin()) {
+    return false;
+  }
 
-  if (*buffer == ',')
-    buffer++; // skip comma for next note (or we may be at the end)
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_PLAY;
+  return queuePlay(command);
+}
 
-  if (note) {
-    tone(notes[(scale - 4) * 12 + note], duration);
+bool IRAM_ATTR RTTTL::playFromISR() {
+  if (!songLoaded || task == nullptr) {
+    return false;
+  }
 
-    noteDelay = millis() + (duration+1);
-  } else {
-    noteDelay = millis() + (duration);
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_PLAY;
+  pendingPlays++;
+  if (!sendFromISR(command)) {
+    pendingPlays--;
+    return false;
   }
+  return true;
 }
 
-bool RTTTL::play() {
-  if (songStart != nullptr) {
-    xTaskNotifyGive(rtttlTaskHandle);
-    playing = true;
-    return true;
+bool IRAM_ATTR RTTTL::playFromISR(const RTTTLSong &song) {
+  if (song.notes == nullptr || task == nullptr) {
+    return false;
   }
 
-  return false;
+  // one slot for both, so the song is never left loaded but not playing
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_PLAY_SONG;
+  command.value = -1; // keep the current volume
+  command.song = song;
+  pendingPlays++;
+  if (!sendFromISR(command)) {
+    pendingPlays--;
+    return false;
+  }
+  songLoaded = true;
+  return true;
 }
 
 bool RTTTL::continuePlaying() {
@@ -230,37 +659,243 @@ bool RTTTL::continuePlaying() {
   }
 
   // are we still playing a note ?
-  unsigned long m = millis();
-  if (m < noteDelay) {
+  int64_t now = esp_timer_get_time();
+  if (!voice.due(now)) {
+    if (sounding && now >= noteEnd) {
+      // silent rest of a staccato or natural note, keep the power lock for
+      // the next one
+      endNote();
+      return true;
+    }
     // wait until the note is completed
+    stepEnvelope();
+    // glide and vibrato both move the frequency, write it once for the two
+    bool retune = stepGlide();
+    if (stepLfo() || retune) {
+      writeFrequency();
+    }
     return true;
   }
 
   //ready to play the next note
-  if (*buffer == '\0') {
+  if (!nextNote()) {
     // no more notes. Reached the end of the last note
 
-    stop(); //end of the song
+    halt(true); //end of the song
     return false;
   }
   // more notes to play...
-  nextNote();
   return true;
 }
 
 void RTTTL::stop() {
-  if (playing) {
-    playing = false;
-    noTone();
-    // reset to beginning of the song
-    buffer = songStart;
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_STOP;
+  if (!send(command)) {
+    // picked up after the commands that filled the queue
+    stopRequested = true;
+    if (task != nullptr) {
+      xTaskNotifyGive(task);
+    }
+  }
+}
+
+void IRAM_ATTR RTTTL::stopFromISR() {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_STOP;
+  if (!sendFromISR(command) && task != nullptr) {
+    BaseType_t woken = pdFALSE;
+    stopRequested = true;
+    vTaskNotifyGiveFromISR(task, &woken);
+    portYIELD_FROM_ISR(woken);
   }
 }
 
+void RTTTL::halt(bool finished) {
+  if (!playing) {
+    return;
+  }
+
+  playing = false;
+  endNote();
+  holdPower(false);
+  // reset to beginning of the song
+  voice.stop();
+
+  if (finished && songEndCallback) {
+    songEndCallback(songEndArg);
+  }
+
+  xEventGroupSetBits(doneGroup, DONE_BIT);
+  if (doneQueue != nullptr) {
+    RTTTLDoneEvent event = { this, finished };
+    xQueueSend(doneQueue, &event, 0);
+  }
+  if (doneEvents != nullptr) {
+    xEventGroupSetBits(doneEvents, doneEventBits);
+  }
+}
+
+bool RTTTL::waitUntilDone(TickType_t timeout) {
+  TickType_t start = xTaskGetTickCount();
+
+  if (task == nullptr) {
+    return true;
+  }
+
+  // play() and sweep() clear the bit when they queue, but playFromISR()
+  // cannot, so the bit can still be up while its command is on the way;
+  // give the engine a tick to pick it up rather than spinning
+  while (isPlaying()) {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (timeout != portMAX_DELAY && elapsed >= timeout) {
+      return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(doneGroup, DONE_BIT, pdFALSE, pdTRUE,
+                                           timeout == portMAX_DELAY ? portMAX_DELAY : timeout - elapsed);
+    if ((bits & DONE_BIT) && isPlaying()) {
+      vTaskDelay(1);
+    }
+  }
+  return true;
+}
+
+bool RTTTL::notifyOnDone(QueueHandle_t queue) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_DONE_QUEUE;
+  command.handle = queue;
+  return send(command);
+}
+
+bool RTTTL::notifyOnDone(EventGroupHandle_t group, EventBits_t bits) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_DONE_EVENTS;
+  command.handle = group;
+  command.value = (int)bits;
+  return send(command);
+}
+
+bool RTTTL::setVolume(const int volume) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_VOLUME;
+  command.value = volume;
+  return send(command);
+}
+
+bool RTTTL::setEnvelope(const RTTTLEnvelope &envelope) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_ENVELOPE;
+  command.envelope = envelope;
+  return send(command);
+}
+
+bool RTTTL::setPortamento(const uint16_t ms, const RTTTLSweepCurve curve) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_PORTAMENTO;
+  command.value = ms;
+  command.curve = curve;
+  return send(command);
+}
+
+bool RTTTL::sweep(const uint16_t from, const uint16_t to, const uint32_t ms, const RTTTLSweepCurve curve) {
+  // the playback clock counts microseconds in 32 bits
+  if (from == 0 || to == 0 || ms > RTTTL_SWEEP_MAX_MS || !begin()) {
+    return false;
+  }
+
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_SWEEP;
+  command.duration = ms;
+  command.from = from;
+  command.to = to;
+  command.curve = curve;
+  if (!queuePlay(command)) {
+    return false;
+  }
+  songLoaded = true;
+  return true;
+}
+
+bool RTTTL::setVibrato(const float rate, const uint16_t cents) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_VIBRATO;
+  command.rate = rate > 0 ? (uint32_t)(rate * 1000) : 0;
+  // small intervals are close enough to linear: ln(2) / 1200 per cent
+  command.value = (int)(cents * 0.00057762265f * 65536);
+  return send(command);
+}
+
+bool RTTTL::setTremolo(const float rate, const uint8_t depth) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_TREMOLO;
+  command.rate = rate > 0 ? (uint32_t)(rate * 1000) : 0;
+  // the sine swings by half the depth around the middle of the dip
+  command.value = (depth > 100 ? 100 : depth) * 65536 / 200;
+  return send(command);
+}
+
+bool RTTTL::setTempo(const int percent) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_TEMPO;
+  command.value = percent;
+  return send(command);
+}
+
+bool RTTTL::onNoteOn(RTTTLNoteCallback callback, void *arg) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_NOTE_ON;
+  command.callback = (void (*)())callback;
+  command.arg = arg;
+  return send(command);
+}
+
+bool RTTTL::onNoteOff(RTTTLNoteCallback callback, void *arg) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_NOTE_OFF;
+  command.callback = (void (*)())callback;
+  command.arg = arg;
+  return send(command);
+}
+
+bool RTTTL::onSongEnd(RTTTLSongEndCallback callback, void *arg) {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_SONG_END;
+  command.callback = (void (*)())callback;
+  command.arg = arg;
+  return send(command);
+}
+
+uint32_t RTTTL::stackHighWaterMark() {
+  return task != nullptr ? uxTaskGetStackHighWaterMark(task) : 0;
+}
+
 bool RTTTL::done() {
-  return !playing;
+  return !isPlaying();
 }
 
 bool RTTTL::isPlaying() {
-  return playing;
+  // a play() the engine has not picked up yet already counts as playing
+  return playing || pendingPlays > 0;
+}
+
+#if RTTTL_JITTER_STATS
+void RTTTL::jitter(RTTTLJitter &snapshot) {
+  portENTER_CRITICAL(&jitterLock);
+  snapshot = jitterStats;
+  portEXIT_CRITICAL(&jitterLock);
+}
+
+bool RTTTL::resetJitter() {
+  RTTTLCommand command = {};
+  command.type = RTTTL_COMMAND_JITTER_RESET;
+  return send(command);
+}
+#endif
+
+RTTTLPosition RTTTL::position() {
+  return voice.progress().read(esp_timer_get_time());
+}
+
+uint16_t RTTTL::progress() {
+  return RTTTLProgress::perMille(position());
 }
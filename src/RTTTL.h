@@ -1,142 +1,278 @@
 #ifndef RTTTL_h
 #define RTTTL_h
 
+#include <sdkconfig.h>
 #include <driver/gpio.h>
-#include <driver/ledc.h>
+#include <esp_attr.h>
 #include <esp_timer.h>
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include <atomic>
+
+#include "RTTTLCommandQueue.h"
+#include "RTTTLEffects.h"
+#include "RTTTLFrontEnd.h"
+#include "RTTTLJitter.h"
+#include "RTTTLLedc.h"
+#include "RTTTLMML.h"
+#include "RTTTLMcpwm.h"
+#include "RTTTLNokia.h"
+#include "RTTTLOutput.h"
+#include "RTTTLParser.h"
+#include "RTTTLProgress.h"
+#include "RTTTLSequencer.h"
+#include "RTTTLSdm.h"
+#include "RTTTLVoice.h"
+#include "RTTTLVolume.h"
+
+// Passed to the note callbacks. A pause does not produce note events.
+struct RTTTLNoteEvent {
+  size_t index;       // position of the note in the song
+  uint16_t frequency;
+  uint32_t duration;  // milliseconds
+};
+
+// Callbacks run on the playback task right after the output has changed and
+// before it waits for the next note, so their run time adds directly to the
+// timing of the next note edge. Keep them short and never block in them; an
+// unset callback costs a single pointer check.
+typedef void (*RTTTLNoteCallback)(const RTTTLNoteEvent &event, void *arg);
+typedef void (*RTTTLSongEndCallback)(void *arg);
+
+class RTTTL;
+
+// Posted to the queue given to notifyOnDone() whenever a song ends.
+struct RTTTLDoneEvent {
+  RTTTL * player;
+  bool finished;  // false if the song was stopped
+};
+
+// Stack of the playback task in bytes. Enough for the engine itself plus short
+// note callbacks; check stackHighWaterMark() when callbacks do more.
+#ifndef RTTTL_TASK_STACK_SIZE
+#define RTTTL_TASK_STACK_SIZE 3072
+#endif
+
+// RAM one player and its default LEDC output may take on the target,
+// checked when RTTTL.cpp is compiled so growth shows up as a build error
+// rather than as lost heap. Raise them when that growth is wanted. The
+// player's budget leaves out its command queue and jitter record, which
+// RTTTL_COMMAND_QUEUE_SIZE and RTTTL_JITTER_STATS already size.
+#ifndef RTTTL_RAM_BUDGET
+#define RTTTL_RAM_BUDGET 768
+#endif
+
+#ifndef RTTTL_LEDC_RAM_BUDGET
+#define RTTTL_LEDC_RAM_BUDGET 512
+#endif
 
-#define NOTE_H   0
-#define NOTE_B0  31
-#define NOTE_C1  33
-#define NOTE_CS1 35
-#define NOTE_D1  37
-#define NOTE_DS1 39
-#define NOTE_E1  41
-#define NOTE_F1  44
-#define NOTE_FS1 46
-#define NOTE_G1  49
-#define NOTE_GS1 52
-#define NOTE_A1  55
-#define NOTE_AS1 58
-#define NOTE_B1  62
-#define NOTE_C2  65
-#define NOTE_CS2 69
-#define NOTE_D2  73
-#define NOTE_DS2 78
-#define NOTE_E2  82
-#define NOTE_F2  87
-#define NOTE_FS2 93
-#define NOTE_G2  98
-#define NOTE_GS2 104
-#define NOTE_A2  110
-#define NOTE_AS2 117
-#define NOTE_B2  123
-#define NOTE_C3  131
-#define NOTE_CS3 139
-#define NOTE_D3  147
-#define NOTE_DS3 156
-#define NOTE_E3  165
-#define NOTE_F3  175
-#define NOTE_FS3 185
-#define NOTE_G3  196
-#define NOTE_GS3 208
-#define NOTE_A3  220
-#define NOTE_AS3 233
-#define NOTE_B3  247
-#define NOTE_C4  262
-#define NOTE_CS4 277
-#define NOTE_D4  294
-#define NOTE_DS4 311
-#define NOTE_E4  330
-#define NOTE_F4  349
-#define NOTE_FS4 370
-#define NOTE_G4  392
-#define NOTE_GS4 415
-#define NOTE_A4  440
-#define NOTE_AS4 466
-#define NOTE_B4  494
-#define NOTE_C5  523
-#define NOTE_CS5 554
-#define NOTE_D5  587
-#define NOTE_DS5 622
-#define NOTE_E5  659
-#define NOTE_F5  698
-#define NOTE_FS5 740
-#define NOTE_G5  784
-#define NOTE_GS5 831
-#define NOTE_A5  880
-#define NOTE_AS5 932
-#define NOTE_B5  988
-#define NOTE_C6  1047
-#define NOTE_CS6 1109
-#define NOTE_D6  1175
-#define NOTE_DS6 1245
-#define NOTE_E6  1319
-#define NOTE_F6  1397
-#define NOTE_FS6 1480
-#define NOTE_G6  1568
-#define NOTE_GS6 1661
-#define NOTE_A6  1760
-#define NOTE_AS6 1865
-#define NOTE_B6  1976
-#define NOTE_C7  2093
-#define NOTE_CS7 2217
-#define NOTE_D7  2349
-#define NOTE_DS7 2489
-#define NOTE_E7  2637
-#define NOTE_F7  2794
-#define NOTE_FS7 2960
-#define NOTE_G7  3136
-#define NOTE_GS7 3322
-#define NOTE_A7  3520
-#define NOTE_AS7 3729
-#define NOTE_B7  3951
-#define NOTE_C8  4186
-#define NOTE_CS8 4435
-#define NOTE_D8  4699
-#define NOTE_DS8 4978
-
-#define OCTAVE_OFFSET 0
+// How the playback task is created. When stack and taskBuffer are both given
+// the task is created statically in them and nothing is taken from the heap;
+// the stack has to hold stackSize bytes and both must outlive the player.
+struct RTTTLConfig {
+  UBaseType_t priority = 1;
+  BaseType_t core = portNUM_PROCESSORS > 1 ? 1 : 0; // or tskNO_AFFINITY
+  uint32_t stackSize = RTTTL_TASK_STACK_SIZE;
+  StackType_t * stack = nullptr;
+  StaticTask_t * taskBuffer = nullptr;
+  // Output updates per second for sweeps, portamento, vibrato and tremolo.
+  uint16_t effectRate = RTTTL_EFFECT_RATE;
+};
 
+// All control calls are posted to a lock-free queue and carried out by the
+// playback task, which owns the song and the output. Callers never block
+// on the engine and can call in from any task.
 class RTTTL {
 
 private:
-  const int notes[49] = { 0,
-    NOTE_C4, NOTE_CS4, NOTE_D4, NOTE_DS4, NOTE_E4, NOTE_F4, NOTE_FS4, NOTE_G4, NOTE_GS4, NOTE_A4, NOTE_AS4, NOTE_B4,
-    NOTE_C5, NOTE_CS5, NOTE_D5, NOTE_DS5, NOTE_E5, NOTE_F5, NOTE_FS5, NOTE_G5, NOTE_GS5, NOTE_A5, NOTE_AS5, NOTE_B5,
-    NOTE_C6, NOTE_CS6, NOTE_D6, NOTE_DS6, NOTE_E6, NOTE_F6, NOTE_FS6, NOTE_G6, NOTE_GS6, NOTE_A6, NOTE_AS6, NOTE_B6,
-    NOTE_C7, NOTE_CS7, NOTE_D7, NOTE_DS7, NOTE_E7, NOTE_F7, NOTE_FS7, NOTE_G7, NOTE_GS7, NOTE_A7, NOTE_AS7, NOTE_B7
-  };
-
-  const char * buffer = nullptr;
-  const char * songStart = nullptr;
-  int bufferIndex = -32760;
-  uint8_t defaultDur = 4;
-  uint8_t defaultOct = 5;
-  int bpm = 63;
-  long wholenote;
-  gpio_num_t pin = GPIO_NUM_MAX;
-  unsigned long noteDelay = 0; //m will always be after which means the last note is done playing
-  bool playing = false;
+  RTTTLVoice voice;
+  RTTTLCommandQueue commands;
+  std::atomic<TaskHandle_t> task{nullptr};
+  std::atomic<bool> starting{false};
+  esp_timer_handle_t wakeTimer = nullptr;
+#if CONFIG_PM_ENABLE
+  esp_pm_lock_handle_t apbLock = nullptr;
+  esp_pm_lock_handle_t sleepLock = nullptr;
+#endif
+  bool powerHeld = false;
+  enum EnvelopeStage : uint8_t { ENVELOPE_IDLE, ENVELOPE_ATTACK, ENVELOPE_DECAY, ENVELOPE_SUSTAIN };
+  RTTTLEnvelope envelope;
+  EnvelopeStage envelopeStage = ENVELOPE_IDLE;
+  int64_t envelopeDeadline = 0;
+  uint32_t attackTime = 0;
+  uint32_t decayTime = 0;
+  uint32_t releaseTime = 0;
+  bool fading = false;
+  gpio_num_t pin = GPIO_NUM_NC;   // for the LEDC output begin() makes
   ledc_channel_t channel = LEDC_CHANNEL_0;
-  int volume = 10;
   ledc_timer_t timer = LEDC_TIMER_0;
+  RTTTLLedcOutput * ledc = nullptr;
+  RTTTLOutput * output = nullptr;
+  bool tuned = false;     // the output makes the current frequency
+  uint16_t baseFrequency = 0;
+  uint32_t level = 0;     // duty the envelope asks for, before tremolo
+  int64_t fadeEnd = 0;
+  std::atomic<bool> playing{false};
+  std::atomic<int> pendingPlays{0};
+  std::atomic<bool> songLoaded{false};
+  std::atomic<bool> stopRequested{false};  // a stop that found the queue full
+  int volume = 10;
+#if RTTTL_JITTER_STATS
+  RTTTLJitter jitterStats;
+  portMUX_TYPE jitterLock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+  RTTTLNoteEvent current = {};
+  bool sounding = false;
+  int64_t noteEnd = 0;          // when the current note goes quiet
+  uint8_t noteAttenuation = 0;
+  RTTTLNoteCallback noteOnCallback = nullptr;
+  void * noteOnArg = nullptr;
+  RTTTLNoteCallback noteOffCallback = nullptr;
+  void * noteOffArg = nullptr;
+  RTTTLSongEndCallback songEndCallback = nullptr;
+  void * songEndArg = nullptr;
+  RTTTLConfig config;
+  static const EventBits_t DONE_BIT = 1;
+  static const EventBits_t ENDED_BIT = 2;
+  StaticEventGroup_t doneGroupBuffer;
+  EventGroupHandle_t doneGroup = nullptr;
+  QueueHandle_t doneQueue = nullptr;
+  EventGroupHandle_t doneEvents = nullptr;
+  EventBits_t doneEventBits = 0;
 
-  void nextNote();
+  bool send(const RTTTLCommand &command);
+  bool sendFromISR(const RTTTLCommand &command);
+  bool queuePlay(const RTTTLCommand &command);
+  bool setUp();
+  void tearDown();
+  void processCommands();
+  void startSong();
+  bool continuePlaying();
+  void wakeAtNextNote();
+  void holdPower(bool hold);
+  bool nextNote();
+  void endNote();
+  void halt(bool finished);
   void noTone();
-  void tone(uint32_t frq, uint32_t duration);
-  bool isdigit(char c) { return (c >= '0') and (c <= '9'); }
-  unsigned long millis() { return (unsigned long) (esp_timer_get_time() / 1000ULL); }
+  void tone(uint32_t frq);
+  void setDuty(uint32_t duty);
+  void fade(uint32_t duty, uint32_t ms);
+  void startEnvelope(int64_t start, uint32_t length);
+  void stepEnvelope();
+  bool stepGlide();
+  bool stepLfo();
+  void writeFrequency();
+  uint32_t duty();
+
+  friend void rtttlTask(void *param);
+  friend void rtttlWake(void *param);
 
 public:
-  RTTTL(const gpio_num_t pin, const ledc_channel_t channel = LEDC_CHANNEL_0, const ledc_timer_t timer = LEDC_TIMER_0);
-  void loadSong(const char *song);
-  void loadSong(const char *song, const int volume);
+  // Plays through LEDC. RTTTL_LEDC_CHANNEL_AUTO and RTTTL_LEDC_TIMER_AUTO
+  // take them from RTTTLLedcPool instead, see RTTTLLedcPool.h. The LEDC output
+  // is taken from the heap by the first begin(), so players on other outputs
+  // do not carry one.
+  RTTTL(const gpio_num_t pin, const ledc_channel_t channel = LEDC_CHANNEL_0, const ledc_timer_t timer = LEDC_TIMER_0,
+        const RTTTLConfig &config = RTTTLConfig());
+  // Plays through another output, see RTTTLOutput.h. The output belongs to the
+  // player from begin() to end() and has to outlive it.
+  RTTTL(RTTTLOutput &output, const RTTTLConfig &config = RTTTLConfig());
+  ~RTTTL();
+  // Sets up the output and starts the playback task. The constructor only
+  // stores its arguments, so a global player costs nothing at boot; play()
+  // calls begin() when needed. Returns false if the output or the task could
+  // not be set up.
+  bool begin();
+  // Stops playback, deletes the task and releases the output and its pin.
+  // Do not call it concurrently with other calls on the same player.
+  void end();
+  // Volume goes from 0 to RTTTL_MAX_VOLUME. Returns false if the song could not
+  // be queued.
+  bool loadSong(const char *song);
+  bool loadSong(const char *song, const int volume);
+  // Loads a song in another text format, see RTTTLFrontEnd.h. The front-end
+  // is used by the playback task until another song is loaded, so it has to
+  // stay alive and must not be used elsewhere meanwhile.
+  bool loadSong(const char *song, RTTTLFrontEnd &format, const int volume = 10);
+  bool loadSong(const RTTTLSong &song);
+  bool loadSong(const RTTTLSong &song, const int volume);
   bool play();
+  // Never lost: when the queue is full the stop is flagged instead and
+  // carried out after the commands already queued.
   void stop();
+  // The setters below return false if the command could not be queued.
+  // Takes effect from the next note.
+  bool setVolume(const int volume);
+  // Attack/decay/sustain/release applied to every note from the next one on.
+  // The LEDC output runs the ramps on its fade hardware and the task only
+  // starts each one; outputs without fade hardware jump to each level.
+  bool setEnvelope(const RTTTLEnvelope &envelope);
+  // Glides into every note from the one before it over ms, or the whole note
+  // if it is shorter. Pauses break the glide. 0 turns it off.
+  bool setPortamento(const uint16_t ms, const RTTTLSweepCurve curve = RTTTL_SWEEP_EXPONENTIAL);
+  // Plays one tone sweeping from one frequency to the other over ms, in place
+  // of the loaded song (sirens, chirps, risers). Stepped at effectRate.
+  // Returns false for ms over RTTTL_SWEEP_MAX_MS.
+  bool sweep(const uint16_t from, const uint16_t to, const uint32_t ms,
+             const RTTTLSweepCurve curve = RTTTL_SWEEP_EXPONENTIAL);
+  // Sine vibrato of +-cents around every note, at rate Hz. 0 cents turns it off.
+  bool setVibrato(const float rate, const uint16_t cents);
+  // Sine tremolo dipping the level by up to depth percent, at rate Hz. 0 turns
+  // it off. Paused while an envelope ramp runs on the fade hardware.
+  bool setTremolo(const float rate, const uint8_t depth);
+  // Playback speed in percent of the song's own tempo, from the next note.
+  bool setTempo(const int percent);
+  // Interrupt safe variants, placed in IRAM. begin() must have been called.
+  // They queue the command and yield to the playback task on return from the
+  // interrupt, so the first note starts without waiting for another task to
+  // pass the request on.
+  // playFromISR(song) loads a compiled song at the current volume; its notes
+  // have to stay valid while it plays. Parsing text songs is left to loadSong().
+  bool playFromISR();
+  bool playFromISR(const RTTTLSong &song);
+  void stopFromISR();
   bool isPlaying();
   bool done();
-  bool continuePlaying();
+  // Where playback is: the note, the time played and the length of the song.
+  // A few atomic loads that never wait on the playback task, so any task can
+  // poll it, e.g. for a progress bar. Follows the note schedule rather than a
+  // clock of its own, so it does not drift from what is heard.
+  RTTTLPosition position();
+  // Share of the song played in per mille, 0 when stopped. Songs that loop
+  // forever count one pass.
+  uint16_t progress();
+  // Blocks the calling task until the song has ended or was stopped. Returns
+  // false if it is still playing after timeout ticks.
+  bool waitUntilDone(TickType_t timeout = portMAX_DELAY);
+  // Also report the end of every song to a queue of RTTTLDoneEvent, or by
+  // setting bits in an event group. Pass nullptr to remove. Queued like the
+  // other control calls; returns false if that failed.
+  bool notifyOnDone(QueueHandle_t queue);
+  bool notifyOnDone(EventGroupHandle_t group, EventBits_t bits);
+  // Least free stack the playback task has had so far, in bytes.
+  uint32_t stackHighWaterMark();
+  // Called when a note starts sounding, when it stops and when the song has
+  // played to the end (not when it is stopped). Pass nullptr to remove. The
+  // callback and its arg reach the playback task together through the command
+  // queue; returns false if that failed.
+  bool onNoteOn(RTTTLNoteCallback callback, void *arg = nullptr);
+  bool onNoteOff(RTTTLNoteCallback callback, void *arg = nullptr);
+  bool onSongEnd(RTTTLSongEndCallback callback, void *arg = nullptr);
+#if RTTTL_JITTER_STATS
+  // Copies the scheduled versus actual note edge times recorded so far into
+  // snapshot, see RTTTLJitter.h. The copy is taken in a short critical
+  // section, so it is consistent and safe from any task; work out stats()
+  // on the copy.
+  void jitter(RTTTLJitter &snapshot);
+  // Starts the record over, queued like the other control calls.
+  bool resetJitter();
+#endif
 };
 
 #endif
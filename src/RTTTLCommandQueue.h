@@ -0,0 +1,118 @@
+#ifndef RTTTLCommandQueue_h
+#define RTTTLCommandQueue_h
+
+#include <atomic>
+#include <stdint.h>
+
+#include "RTTTLEffects.h"
+#include "RTTTLParser.h"
+
+// Number of control calls that can be waiting for the engine. Must be a power
+// of two.
+#ifndef RTTTL_COMMAND_QUEUE_SIZE
+#define RTTTL_COMMAND_QUEUE_SIZE 8
+#endif
+static_assert(RTTTL_COMMAND_QUEUE_SIZE > 0 && (RTTTL_COMMAND_QUEUE_SIZE & (RTTTL_COMMAND_QUEUE_SIZE - 1)) == 0,
+              "RTTTL_COMMAND_QUEUE_SIZE must be a power of two");
+
+enum RTTTLCommandType : uint8_t {
+  RTTTL_COMMAND_LOAD_TEXT,
+  RTTTL_COMMAND_LOAD_SONG,
+  RTTTL_COMMAND_PLAY_SONG,  // LOAD_SONG and PLAY in one slot, for playFromISR()
+  RTTTL_COMMAND_PLAY,
+  RTTTL_COMMAND_STOP,
+  RTTTL_COMMAND_VOLUME,
+  RTTTL_COMMAND_TEMPO,
+  RTTTL_COMMAND_ENVELOPE,
+  RTTTL_COMMAND_PORTAMENTO,
+  RTTTL_COMMAND_SWEEP,
+  RTTTL_COMMAND_VIBRATO,
+  RTTTL_COMMAND_TREMOLO,
+  RTTTL_COMMAND_NOTE_ON,
+  RTTTL_COMMAND_NOTE_OFF,
+  RTTTL_COMMAND_SONG_END,
+  RTTTL_COMMAND_DONE_QUEUE,
+  RTTTL_COMMAND_DONE_EVENTS,
+  RTTTL_COMMAND_JITTER_RESET,
+  RTTTL_COMMAND_END
+};
+
+// A control call on its way from an API caller to the playback engine.
+struct RTTTLCommand {
+  RTTTLCommandType type;
+  int value;          // volume, tempo, effect time in ms or LFO depth
+  const char * text;  // RTTTL_COMMAND_LOAD_TEXT
+  RTTTLFrontEnd * format;
+  RTTTLSong song;     // RTTTL_COMMAND_LOAD_SONG and RTTTL_COMMAND_PLAY_SONG
+  RTTTLEnvelope envelope;
+  uint16_t from;      // RTTTL_COMMAND_SWEEP
+  uint16_t to;
+  RTTTLSweepCurve curve;
+  uint32_t duration;  // RTTTL_COMMAND_SWEEP in ms
+  uint32_t rate;      // LFO rate in mHz
+  void (*callback)(); // note and song end callbacks, cast back by the engine
+  void * handle;      // done queue or event group
+  void * arg;         // for the callback
+};
+
+// Bounded lock-free queue with any number of producers and a single consumer.
+// Every slot carries a sequence number telling whether it is free for the
+// producer that claimed it or filled for the consumer, so neither side ever
+// waits on a lock. Everything is inline so it can be used from an ISR.
+class RTTTLCommandQueue {
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    RTTTLCommand command;
+  };
+
+  Slot slots[RTTTL_COMMAND_QUEUE_SIZE];
+  std::atomic<uint32_t> head;
+  uint32_t tail = 0;
+
+public:
+  RTTTLCommandQueue() : head(0) {
+    for (uint32_t i = 0; i < RTTTL_COMMAND_QUEUE_SIZE; i++) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Returns false if the queue is full. Safe from any task or ISR; always
+  // inlined so an IRAM caller does not end up calling into flash.
+  inline __attribute__((always_inline)) bool push(const RTTTLCommand &command) {
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    while (true) {
+      Slot &slot = slots[pos & (RTTTL_COMMAND_QUEUE_SIZE - 1)];
+      int32_t diff = (int32_t)(slot.sequence.load(std::memory_order_acquire) - pos);
+      if (diff == 0) {
+        // slot is free, try to claim it
+        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          slot.command = command;
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // consumer has not freed this slot yet
+        return false;
+      } else {
+        // another producer claimed it first
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Returns false if there is nothing to take. Only call from the consumer.
+  bool pop(RTTTLCommand &command) {
+    Slot &slot = slots[tail & (RTTTL_COMMAND_QUEUE_SIZE - 1)];
+    if ((int32_t)(slot.sequence.load(std::memory_order_acquire) - (tail + 1)) < 0) {
+      return false;
+    }
+    command = slot.command;
+    slot.sequence.store(tail + RTTTL_COMMAND_QUEUE_SIZE, std::memory_order_release);
+    tail++;
+    return true;
+  }
+};
+
+#endif
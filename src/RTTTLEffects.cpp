@@ -0,0 +1,70 @@
+/*
+ * Fixed-point effect generators for the RTTTL player.
+ */
+
+#include "RTTTLEffects.h"
+
+#include <math.h>
+
+// one sine cycle in 1.15 fixed point, plus the first entry again for the
+// interpolation
+static const int16_t sine[65] = {
+  0, 3212, 6393, 9512, 12539, 15446, 18204, 20787,
+  23170, 25329, 27245, 28898, 30273, 31356, 32137, 32609,
+  32767, 32609, 32137, 31356, 30273, 28898, 27245, 25329,
+  23170, 20787, 18204, 15446, 12539, 9512, 6393, 3212,
+  0, -3212, -6393, -9512, -12539, -15446, -18204, -20787,
+  -23170, -25329, -27245, -28898, -30273, -31356, -32137, -32609,
+  -32767, -32609, -32137, -31356, -30273, -28898, -27245, -25329,
+  -23170, -20787, -18204, -15446, -12539, -9512, -6393, -3212,
+  0
+};
+
+void RTTTLSweep::start(uint16_t from, uint16_t to, uint32_t steps, RTTTLSweepCurve curve) {
+  if (from == 0) from = 1;
+  if (to == 0) to = 1;
+  if (steps == 0) steps = 1;
+
+  this->curve = curve;
+  frequency = (uint32_t)from << 16;
+  target = (uint32_t)to << 16;
+  remaining = steps;
+
+  if (curve == RTTTL_SWEEP_EXPONENTIAL) {
+    // once per sweep, never per step
+    double step = pow((double)to / from, 1.0 / steps);
+    if (step > 255.0) step = 255.0;
+    ratio = (uint32_t)(step * (1 << 24) + 0.5);
+  } else {
+    increment = (int32_t)(((int64_t)target - (int64_t)frequency) / (int64_t)steps);
+  }
+}
+
+uint16_t RTTTLSweep::next() {
+  if (remaining == 0) {
+    return current();
+  }
+
+  if (--remaining == 0) {
+    frequency = target;
+  } else if (curve == RTTTL_SWEEP_EXPONENTIAL) {
+    frequency = (uint32_t)(((uint64_t)frequency * ratio) >> 24);
+  } else {
+    frequency += increment;
+  }
+  return current();
+}
+
+void RTTTLLfo::set(uint32_t milliHertz, uint32_t updateRate, int32_t depth) {
+  if (updateRate == 0) updateRate = 1;
+  increment = (uint32_t)(((uint64_t)milliHertz << 32) / (1000ULL * updateRate));
+  this->depth = depth;
+}
+
+int32_t RTTTLLfo::value() const {
+  // top 6 bits pick the table entry, the next 16 interpolate to the next one
+  uint32_t i = phase >> 26;
+  int32_t fraction = (phase >> 10) & 0xFFFF;
+  int32_t s = sine[i] + (((sine[i + 1] - sine[i]) * fraction) >> 16);
+  return (int32_t)(((int64_t)s * depth) >> 15);
+}
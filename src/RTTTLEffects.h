@@ -0,0 +1,79 @@
+#ifndef RTTTLEffects_h
+#define RTTTLEffects_h
+
+#include <stdint.h>
+
+// Update rate of frequency sweeps, portamento and other effects that need the
+// output to change during a note, in updates per second.
+#ifndef RTTTL_EFFECT_RATE
+#define RTTTL_EFFECT_RATE 500
+#endif
+
+// Longest sweep, about 71 minutes, before its microseconds overflow 32 bits.
+#define RTTTL_SWEEP_MAX_MS (UINT32_MAX / 1000)
+
+// Shapes the level of every note. The level ramps up from silence over attack
+// ms, falls to sustain percent of the note's level over decay ms and ramps
+// back to silence over the last release ms of the note. When a note is too
+// short, attack is kept first, then release, then decay. All zero plays notes
+// at a constant level.
+struct RTTTLEnvelope {
+  uint16_t attack = 0;
+  uint16_t decay = 0;
+  uint8_t sustain = 100;
+  uint16_t release = 0;
+
+  bool enabled() const { return attack || release || (sustain < 100); }
+};
+
+enum RTTTLSweepCurve : uint8_t {
+  RTTTL_SWEEP_LINEAR,      // same number of Hz every step
+  RTTTL_SWEEP_EXPONENTIAL  // same musical interval every step
+};
+
+// Moves a frequency from one value to another in a fixed number of steps. The
+// curve is reduced to a fixed-point increment or ratio when the sweep starts,
+// so each step costs one add or one multiply and no floating point.
+class RTTTLSweep {
+
+private:
+  uint32_t frequency = 0; // Hz, 16.16 fixed point
+  uint32_t target = 0;
+  int32_t increment = 0;  // linear, 16.16
+  uint32_t ratio = 0;     // exponential, 8.24
+  uint32_t remaining = 0;
+  RTTTLSweepCurve curve = RTTTL_SWEEP_LINEAR;
+
+public:
+  void start(uint16_t from, uint16_t to, uint32_t steps, RTTTLSweepCurve curve);
+  void stop() { remaining = 0; }
+  bool active() const { return remaining > 0; }
+  uint16_t current() const { return (frequency + 0x8000) >> 16; }
+  // Advances one step and returns the new frequency in Hz. The last step lands
+  // exactly on the target.
+  uint16_t next();
+};
+
+// Low frequency sine oscillator for vibrato and tremolo. The phase is a 32 bit
+// accumulator and the sine comes from a 64 entry table with linear
+// interpolation, so an update is an add, a lookup and two multiplies.
+class RTTTLLfo {
+
+private:
+  uint32_t phase = 0;
+  uint32_t increment = 0;
+  int32_t depth = 0; // 16.16 fixed point
+
+public:
+  // Runs at milliHertz / 1000 cycles per second when advanced updateRate times
+  // per second, swinging between -depth and +depth.
+  void set(uint32_t milliHertz, uint32_t updateRate, int32_t depth);
+  bool enabled() const { return increment != 0 && depth != 0; }
+  int32_t range() const { return depth; }
+  void reset() { phase = 0; }
+  void advance(uint32_t steps) { phase += increment * steps; }
+  // Current output in 16.16 fixed point.
+  int32_t value() const;
+};
+
+#endif
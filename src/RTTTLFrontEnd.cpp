@@ -0,0 +1,95 @@
+/*
+ * Shared parts of the song format front-ends.
+ */
+
+#include "RTTTLFrontEnd.h"
+#include "RTTTLParser.h"
+
+// octave 8, the lower octaves are derived by halving
+static const uint16_t octave8[12] = {
+  NOTE_C8, NOTE_CS8, NOTE_D8, NOTE_DS8, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902
+};
+
+uint16_t RTTTLFrontEnd::frequency(int semitone, int octave) {
+  while (semitone < 0) {
+    semitone += 12;
+    octave--;
+  }
+  octave += semitone / 12;
+  semitone %= 12;
+  if (octave < 0) octave = 0;
+  if (octave > 8) octave = 8;
+  // one extra bit keeps the rounding right after the shift
+  uint32_t doubled = (uint32_t)octave8[semitone] * 2 >> (8 - octave);
+  return (doubled + 1) >> 1;
+}
+
+bool RTTTLFrontEnd::walk(RTTTLFrontEnd &format, const char *song, RTTTLNote *out, size_t maxNotes, size_t &count,
+                         RTTTLSongInfo *info) {
+  RTTTLNote note;
+  bool described = false;
+
+  count = 0;
+  if (info != nullptr) {
+    *info = RTTTLSongInfo();
+  }
+  if (!format.load(song)) {
+    return false;
+  }
+
+  while (format.nextNote(note)) {
+    if (count < maxNotes) {
+      out[count] = note;
+    }
+    if (info != nullptr) {
+      // MML and the like set their tempo and defaults with commands before
+      // the first note
+      if (!described) {
+        format.describe(*info);
+        described = true;
+      }
+      info->add(note);
+    }
+    count++;
+  }
+  if (info != nullptr) {
+    if (!described) {
+      format.describe(*info);
+    }
+    info->loops = format.loops();
+  }
+  return true;
+}
+
+size_t RTTTLFrontEnd::compile(RTTTLFrontEnd &format, const char *song, RTTTLNote *out, size_t maxNotes) {
+  size_t count;
+  walk(format, song, out, maxNotes, count, nullptr);
+  return count;
+}
+
+bool RTTTLFrontEnd::compile(RTTTLFrontEnd &format, const char *song, RTTTLNote *out, size_t maxNotes,
+                            RTTTLSong &compiled, RTTTLSongInfo *info) {
+  size_t count;
+
+  walk(format, song, out, maxNotes, count, info);
+  if (count == 0 || count > maxNotes) {
+    return false;
+  }
+  compiled.notes = out;
+  compiled.count = count;
+  compiled.loops = format.loops();
+  return true;
+}
+
+bool RTTTLFrontEnd::inspect(RTTTLFrontEnd &format, const char *song, RTTTLSongInfo &info) {
+  size_t count;
+  return walk(format, song, nullptr, 0, count, &info);
+}
+
+void RTTTLFrontEnd::inspect(const RTTTLSong &song, RTTTLSongInfo &info) {
+  info = RTTTLSongInfo();
+  info.loops = song.loops;
+  for (size_t i = 0; i < song.count; i++) {
+    info.add(song.notes[i]);
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef RTTTLFrontEnd_h
+#define RTTTLFrontEnd_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct RTTTLNote;
+struct RTTTLSong;
+struct RTTTLSongInfo;
+
+// A text song format. Each front-end turns its own syntax into the RTTTLNote
+// stream the sequencer plays, so any format can be played from text, one note
+// at a time, or compiled ahead of time into an RTTTLSong.
+class RTTTLFrontEnd {
+
+protected:
+  // Equal tempered frequency of semitone 0 (C) to 11 (B) in an octave where
+  // A4 is 440 Hz. Octaves outside 0 to 8 are clamped.
+  static uint16_t frequency(int semitone, int octave);
+  static char lower(char c) { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; }
+
+public:
+  virtual ~RTTTLFrontEnd() { }
+  // Reads the header, if the format has one. Returns false if the text is not
+  // a song in this format.
+  virtual bool load(const char *song) = 0;
+  // Returns false once the song is over.
+  virtual bool nextNote(RTTTLNote &note) = 0;
+  virtual void rewind() = 0;
+  // Extra times the song is played after the first, or RTTTL_LOOP_FOREVER.
+  virtual uint8_t loops() const { return 0; }
+  // Fills in the name, header defaults and starting tempo, as far as the
+  // format has them. Called once the first note has been read, so leading
+  // tempo or length commands count as defaults.
+  virtual void describe(RTTTLSongInfo &info) const { (void)info; }
+
+  // Parses the whole song into notes with the given front-end. Returns the
+  // number of notes in the song, which may be larger than maxNotes, or 0 if
+  // the song could not be parsed.
+  static size_t compile(RTTTLFrontEnd &format, const char *song, RTTTLNote *out, size_t maxNotes);
+  // Same, and fills in compiled with the notes and the loop count. Returns
+  // false if the song could not be parsed or did not fit. When info is given
+  // it is filled in from the same pass, to keep with the compiled song.
+  static bool compile(RTTTLFrontEnd &format, const char *song, RTTTLNote *out, size_t maxNotes,
+                      RTTTLSong &compiled, RTTTLSongInfo *info = nullptr);
+  // Everything RTTTLSongInfo holds in one pass over the song, without storing
+  // the notes. Returns false if the song could not be parsed.
+  static bool inspect(RTTTLFrontEnd &format, const char *song, RTTTLSongInfo &info);
+  // Same for a compiled song, which keeps no name or header.
+  static void inspect(const RTTTLSong &song, RTTTLSongInfo &info);
+
+private:
+  static bool walk(RTTTLFrontEnd &format, const char *song, RTTTLNote *out, size_t maxNotes, size_t &count,
+                   RTTTLSongInfo *info);
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Note edge timing instrumentation for the RTTTL player.
+ */
+
+#include "RTTTLJitter.h"
+
+#include <algorithm>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
+
+int64_t RTTTLJitter::now() {
+#ifdef ESP_PLATFORM
+  return esp_timer_get_time();
+#else
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void RTTTLJitter::record(int64_t scheduled, int64_t actual) {
+  int64_t late = actual - scheduled;
+  if (late > INT32_MAX) late = INT32_MAX;
+  if (late < INT32_MIN) late = INT32_MIN;
+
+  ring[total % RTTTL_JITTER_SAMPLES] = (int32_t)late;
+  total++;
+
+  // early edges are counted in the first bucket
+  size_t i = late > 0 ? (size_t)(late / RTTTL_JITTER_BUCKET_US) : 0;
+  if (i >= RTTTL_JITTER_BUCKETS) i = RTTTL_JITTER_BUCKETS - 1;
+  histogram[i]++;
+}
+
+void RTTTLJitter::reset() {
+  memset(ring, 0, sizeof(ring));
+  memset(histogram, 0, sizeof(histogram));
+  total = 0;
+}
+
+RTTTLJitterStats RTTTLJitter::stats() const {
+  RTTTLJitterStats stats = { 0, 0, 0, 0, 0 };
+  int32_t sorted[RTTTL_JITTER_SAMPLES];
+
+  size_t n = total < RTTTL_JITTER_SAMPLES ? total : RTTTL_JITTER_SAMPLES;
+  if (n == 0) {
+    return stats;
+  }
+
+  memcpy(sorted, ring, n * sizeof(sorted[0]));
+  std::sort(sorted, sorted + n);
+
+  int64_t sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    sum += sorted[i];
+  }
+
+  stats.samples = n;
+  stats.min = sorted[0];
+  stats.max = sorted[n - 1];
+  stats.mean = (int32_t)(sum / (int64_t)n);
+  stats.p99 = sorted[(n * 99 + 99) / 100 - 1];
+  return stats;
+}
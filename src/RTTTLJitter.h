@@ -0,0 +1,60 @@
+#ifndef RTTTLJitter_h
+#define RTTTLJitter_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Set to 1 to record note edge timing in the player.
+#ifndef RTTTL_JITTER_STATS
+#define RTTTL_JITTER_STATS 0
+#endif
+
+// Number of most recent edges kept for min/max/mean/p99.
+#ifndef RTTTL_JITTER_SAMPLES
+#define RTTTL_JITTER_SAMPLES 128
+#endif
+
+// Histogram of lateness since the last reset. The last bucket also counts
+// everything later than the histogram covers.
+#ifndef RTTTL_JITTER_BUCKETS
+#define RTTTL_JITTER_BUCKETS 16
+#endif
+
+#ifndef RTTTL_JITTER_BUCKET_US
+#define RTTTL_JITTER_BUCKET_US 500
+#endif
+
+// Lateness in microseconds over the samples in the ring.
+struct RTTTLJitterStats {
+  uint32_t samples;
+  int32_t min;
+  int32_t max;
+  int32_t mean;
+  int32_t p99;
+};
+
+// Records when note edges were due against when they actually happened.
+class RTTTLJitter {
+
+private:
+  int32_t ring[RTTTL_JITTER_SAMPLES];
+  uint32_t histogram[RTTTL_JITTER_BUCKETS];
+  uint32_t total = 0;
+
+public:
+  RTTTLJitter() { reset(); }
+
+  // Microseconds on esp_timer on the ESP32, steady_clock on the host.
+  static int64_t now();
+
+  void record(int64_t scheduled, int64_t actual);
+  void reset();
+  RTTTLJitterStats stats() const;
+
+  uint32_t count() const { return total; }
+  size_t bucketCount() const { return RTTTL_JITTER_BUCKETS; }
+  uint32_t bucketWidth() const { return RTTTL_JITTER_BUCKET_US; }
+  uint32_t bucket(size_t i) const { return i < RTTTL_JITTER_BUCKETS ? histogram[i] : 0; }
+};
+
+#endif
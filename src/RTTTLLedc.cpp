@@ -0,0 +1,254 @@
+/*
+ * LEDC output for the RTTTL player.
+ */
+
+#include "RTTTLLedc.h"
+
+#include <soc/soc.h>
+#include <soc/soc_caps.h>
+
+#if defined(SOC_LEDC_TIMER_BIT_WIDTH)
+#define RTTTL_MAX_RESOLUTION SOC_LEDC_TIMER_BIT_WIDTH
+#elif defined(SOC_LEDC_TIMER_BIT_WIDE_NUM)
+#define RTTTL_MAX_RESOLUTION SOC_LEDC_TIMER_BIT_WIDE_NUM
+#else
+#define RTTTL_MAX_RESOLUTION 14
+#endif
+
+// clocks a low speed LEDC timer can pick per timer, fastest first
+static const uint32_t ledcClocks[] = {
+  APB_CLK_FREQ,
+#if SOC_LEDC_SUPPORT_REF_TICK
+  REF_CLK_FREQ,
+#endif
+};
+static const ledc_clk_src_t ledcSources[] = {
+  LEDC_APB_CLK,
+#if SOC_LEDC_SUPPORT_REF_TICK
+  LEDC_REF_TICK,
+#endif
+};
+
+RTTTLLedcOutput::RTTTLLedcOutput(const gpio_num_t pin, const ledc_channel_t channel, const ledc_timer_t timer)
+    : RTTTLLedcOutput(&pin, 1, timer, &channel) {
+}
+
+RTTTLLedcOutput::RTTTLLedcOutput(const gpio_num_t *pins, uint8_t count, const ledc_timer_t timer,
+                                 const ledc_channel_t *channels) {
+  if (count > RTTTL_LEDC_GANG_MAX) count = RTTTL_LEDC_GANG_MAX;
+  this->count = count;
+  this->timer = timer;
+  autoChannel = channels == nullptr || channels[0] == RTTTL_LEDC_CHANNEL_AUTO;
+  autoTimer = timer == RTTTL_LEDC_TIMER_AUTO;
+  for (uint8_t i = 0; i < count; i++) {
+    this->pins[i] = pins[i];
+    this->channels[i] = autoChannel ? RTTTL_LEDC_CHANNEL_AUTO : channels[i];
+  }
+  pitch = RTTTLPitch(ledcClocks, sizeof(ledcClocks) / sizeof(ledcClocks[0]), RTTTL_MIN_RESOLUTION,
+                     RTTTL_MAX_RESOLUTION);
+}
+
+bool RTTTLLedcOutput::begin() {
+  uint8_t taken = 0;
+
+  if (started) {
+    return true;
+  }
+  for (; taken < count; taken++) {
+    if (autoChannel) {
+      channels[taken] = RTTTLLedcPool::takeChannel();
+      if (channels[taken] == RTTTL_LEDC_CHANNEL_AUTO) {
+        break;
+      }
+    } else if (!RTTTLLedcPool::reserveChannel(channels[taken])) {
+      break;
+    }
+  }
+  if (taken < count || (!autoTimer && !RTTTLLedcPool::reserveTimer(timer))) {
+    giveChannels(taken);
+    return false;
+  }
+  // from here on end() gives back what was taken
+  started = true;
+
+  if (!autoTimer) {
+    ledc_timer_config_t ledc_timer = {
+        .speed_mode       = LEDC_LOW_SPEED_MODE,
+        .duty_resolution  = LEDC_TIMER_10_BIT,
+        .timer_num        = timer,
+        .freq_hz          = 2093,
+        .clk_cfg          = LEDC_AUTO_CLK
+    };
+    if (ledc_timer_config(&ledc_timer) != ESP_OK) {
+      end();
+      return false;
+    }
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    // a pooled channel waits on timer 0 at duty 0 until its first note
+    ledc_channel_config_t ledc_channel = {
+        .gpio_num       = pins[i],
+        .speed_mode     = LEDC_LOW_SPEED_MODE,
+        .channel        = channels[i],
+        .intr_type      = LEDC_INTR_DISABLE,
+        .timer_sel      = autoTimer ? LEDC_TIMER_0 : timer,
+        .duty           = 0,
+        .hpoint         = 0,
+        .flags          = {0}
+    };
+    if (ledc_channel_config(&ledc_channel) != ESP_OK) {
+      end();
+      return false;
+    }
+  }
+
+  // the fade service and the fade state of each channel are allocated on
+  // first use; doing it here keeps playback itself off the heap. The fade
+  // service is shared by all channels, someone else may own it
+  esp_err_t err = ledc_fade_func_install(0);
+  fadeInstalled = err == ESP_OK || err == ESP_ERR_INVALID_STATE;
+  for (uint8_t i = 0; fadeInstalled && i < count; i++) {
+    ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, channels[i], 0, 1);
+  }
+  return true;
+}
+
+void RTTTLLedcOutput::giveChannels(uint8_t taken) {
+  for (uint8_t i = 0; i < taken; i++) {
+    RTTTLLedcPool::giveChannel(channels[i]);
+    if (autoChannel) {
+      channels[i] = RTTTL_LEDC_CHANNEL_AUTO;
+    }
+  }
+}
+
+void RTTTLLedcOutput::end() {
+  if (!started) {
+    return;
+  }
+  started = false;
+  stopFade();
+  for (uint8_t i = 0; i < count; i++) {
+    ledc_stop(LEDC_LOW_SPEED_MODE, channels[i], 0);
+  }
+  if (autoTimer) {
+    release();
+  } else {
+    ledc_timer_pause(LEDC_LOW_SPEED_MODE, timer);
+    RTTTLLedcPool::unreserveTimer(timer);
+  }
+  giveChannels(count);
+  for (uint8_t i = 0; i < count; i++) {
+    gpio_reset_pin(pins[i]);
+  }
+}
+
+void RTTTLLedcOutput::bind() {
+  for (uint8_t i = 0; i < count; i++) {
+    ledc_bind_channel_timer(LEDC_LOW_SPEED_MODE, channels[i], timer);
+  }
+}
+
+bool RTTTLLedcOutput::tone(uint16_t frequency) {
+  // a frequency no clock can make plays silent rather than off pitch
+  if (!pitch.lookup(frequency, timing)) {
+    return false;
+  }
+  if (autoTimer) {
+    // joins a timer already at this pitch or sets up a free one
+    release();
+    timer = RTTTLLedcPool::takeTimer(timing, ledcSources[timing.clock]);
+    if (timer == RTTTL_LEDC_TIMER_AUTO) {
+      timing.resolution = 0;
+      return false;
+    }
+    bind();
+    return true;
+  }
+  // a few register writes, where ledc_timer_config() searches for a clock
+  // every time; all pins of a gang follow the one timer
+  ledc_timer_set(LEDC_LOW_SPEED_MODE, timer, timing.divider, timing.resolution, ledcSources[timing.clock]);
+  return true;
+}
+
+void RTTTLLedcOutput::retune(uint32_t frequency) {
+  if (timing.resolution == 0) {
+    return;
+  }
+  if (autoTimer) {
+    // the other players on a shared timer must keep their pitch
+    ledc_timer_t own = RTTTLLedcPool::ownTimer(timer, ledcSources[timing.clock]);
+    if (own == RTTTL_LEDC_TIMER_AUTO) {
+      return;
+    }
+    if (own != timer) {
+      timer = own;
+      bind();
+    }
+  }
+  // only the divider changes, the resolution and so the duty stay as they are
+  timing.divider = RTTTLPitch::divider(pitch.clockHz(timing.clock), frequency, timing.resolution);
+  ledc_timer_set(LEDC_LOW_SPEED_MODE, timer, timing.divider, timing.resolution, ledcSources[timing.clock]);
+}
+
+void RTTTLLedcOutput::stopFade() {
+  if (fading) {
+    for (uint8_t i = 0; i < count; i++) {
+      ledc_fade_stop(LEDC_LOW_SPEED_MODE, channels[i]);
+    }
+    fading = false;
+  }
+}
+
+void RTTTLLedcOutput::hold(bool on) {
+  // new duties latch when the timer wraps; while it is paused none of them
+  // can, so every channel of a gang takes its new duty on the same wrap
+  if (count < 2 || timer >= LEDC_TIMER_MAX) {
+    return;
+  }
+  if (on) {
+    ledc_timer_pause(LEDC_LOW_SPEED_MODE, timer);
+  } else {
+    ledc_timer_resume(LEDC_LOW_SPEED_MODE, timer);
+  }
+}
+
+void RTTTLLedcOutput::setDuty(uint32_t duty) {
+  // the pulled side starts its pulse half a period late, the resolution of
+  // the note sets where that is
+  uint32_t half = fullScale() / 2;
+
+  stopFade();
+  hold(true);
+  for (uint8_t i = 0; i < count; i++) {
+    ledc_set_duty_with_hpoint(LEDC_LOW_SPEED_MODE, channels[i], duty, pushPull && (i & 1) ? half : 0);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, channels[i]);
+  }
+  hold(false);
+}
+
+void RTTTLLedcOutput::release() {
+  if (autoTimer && timer != RTTTL_LEDC_TIMER_AUTO) {
+    RTTTLLedcPool::giveTimer(timer);
+    timer = RTTTL_LEDC_TIMER_AUTO;
+  }
+}
+
+bool RTTTLLedcOutput::fade(uint32_t duty, uint32_t ms) {
+  if (!fadeInstalled) {
+    return false;
+  }
+
+  stopFade();
+  // the LEDC hardware steps the duty from here on, no CPU involved; all
+  // ramps start on the same wrap
+  hold(true);
+  for (uint8_t i = 0; i < count; i++) {
+    ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, channels[i], duty, ms);
+    ledc_fade_start(LEDC_LOW_SPEED_MODE, channels[i], LEDC_FADE_NO_WAIT);
+  }
+  hold(false);
+  fading = true;
+  return true;
+}
@@ -0,0 +1,84 @@
+#ifndef RTTTLLedc_h
+#define RTTTLLedc_h
+
+#include <driver/gpio.h>
+#include <driver/ledc.h>
+
+#include "RTTTLLedcPool.h"
+#include "RTTTLOutput.h"
+#include "RTTTLPitch.h"
+
+// Most pins one LEDC output drives in gang mode.
+#ifndef RTTTL_LEDC_GANG_MAX
+#define RTTTL_LEDC_GANG_MAX 4
+#endif
+
+// The default output: one low speed LEDC timer and channel. A note costs a
+// cached lookup and one ledc_timer_set() of a few register writes, with the
+// clock and duty resolution picked per note by RTTTLPitch, which plays from
+// a few Hz up to well past hearing. Envelope ramps run on the LEDC fade
+// hardware.
+//
+// With RTTTL_LEDC_CHANNEL_AUTO or RTTTL_LEDC_TIMER_AUTO the channel or the
+// timer comes from RTTTLLedcPool; a pooled timer is only held while a note
+// sounds and is shared with other players sounding the same pitch.
+//
+// In gang mode several pins, each on a channel of its own, run from the one
+// timer, for louder or spread out alerts from a single player. A note still
+// costs one timer write whatever the number of pins, plus one duty write per
+// pin when it starts and for every envelope or tremolo step.
+//
+// Push-pull drives a piezo across each pair of pins in antiphase: the second
+// pin of a pair pulses half a period after the first, through the LEDC hpoint
+// on the shared timer. That doubles the voltage swing, about 6 dB louder at
+// the same supply, for one more duty write per note.
+//
+// With more than one pin the timer is paused for a few microseconds while
+// the duties or fades of all channels are written, so they latch on the same
+// period boundary rather than a period apart.
+class RTTTLLedcOutput : public RTTTLOutput {
+
+private:
+  gpio_num_t pins[RTTTL_LEDC_GANG_MAX];
+  ledc_channel_t channels[RTTTL_LEDC_GANG_MAX];
+  uint8_t count;
+  ledc_timer_t timer;
+  bool autoChannel;
+  bool autoTimer;
+  bool pushPull = false;
+  RTTTLPitch pitch;
+  RTTTLTimerSetting timing;
+  bool started = false;
+  bool fading = false;
+  bool fadeInstalled = false;
+
+  void giveChannels(uint8_t taken);
+  void bind();
+  void stopFade();
+  void hold(bool on);
+
+public:
+  RTTTLLedcOutput(const gpio_num_t pin, const ledc_channel_t channel = LEDC_CHANNEL_0,
+                  const ledc_timer_t timer = LEDC_TIMER_0);
+  // Gang mode over count pins, up to RTTTL_LEDC_GANG_MAX. Without channels
+  // they all come from RTTTLLedcPool.
+  RTTTLLedcOutput(const gpio_num_t *pins, uint8_t count, const ledc_timer_t timer = RTTTL_LEDC_TIMER_AUTO,
+                  const ledc_channel_t *channels = nullptr);
+
+  // Pairs the pins up for push-pull drive, the first with the second and so
+  // on. Takes effect from the next note.
+  void setPushPull(bool on) { pushPull = on; }
+
+  bool begin() override;
+  void end() override;
+  void clear() override { pitch.clear(); }
+  void prepare(uint16_t frequency) override { pitch.add(frequency); }
+  bool tone(uint16_t frequency) override;
+  void retune(uint32_t frequency) override;
+  uint32_t fullScale() const override { return timing.resolution ? 1UL << timing.resolution : 0; }
+  void setDuty(uint32_t duty) override;
+  void release() override;
+  bool fade(uint32_t duty, uint32_t ms) override;
+};
+
+#endif
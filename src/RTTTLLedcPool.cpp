@@ -0,0 +1,225 @@
+/*
+ * Shared LEDC channels and timers for RTTTL players.
+ */
+
+#include "RTTTLLedcPool.h"
+
+RTTTLLedcPool::Timer RTTTLLedcPool::timers[LEDC_TIMER_MAX] = {};
+bool RTTTLLedcPool::channels[LEDC_CHANNEL_MAX] = {};
+portMUX_TYPE RTTTLLedcPool::lock = portMUX_INITIALIZER_UNLOCKED;
+
+bool RTTTLLedcPool::same(const RTTTLTimerSetting &a, const RTTTLTimerSetting &b) {
+  return a.divider == b.divider && a.resolution == b.resolution && a.clock == b.clock;
+}
+
+bool RTTTLLedcPool::reserveChannel(ledc_channel_t channel) {
+  bool ok = false;
+  if (channel >= LEDC_CHANNEL_MAX) {
+    return false;
+  }
+  portENTER_CRITICAL(&lock);
+  if (!channels[channel]) {
+    channels[channel] = true;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&lock);
+  return ok;
+}
+
+void RTTTLLedcPool::unreserveChannel(ledc_channel_t channel) {
+  if (channel >= LEDC_CHANNEL_MAX) {
+    return;
+  }
+  portENTER_CRITICAL(&lock);
+  channels[channel] = false;
+  portEXIT_CRITICAL(&lock);
+}
+
+bool RTTTLLedcPool::reserveTimer(ledc_timer_t timer) {
+  bool ok = false;
+  if (timer >= LEDC_TIMER_MAX) {
+    return false;
+  }
+  portENTER_CRITICAL(&lock);
+  if (!timers[timer].reserved && !timers[timer].pending && timers[timer].users == 0) {
+    timers[timer].reserved = true;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&lock);
+  return ok;
+}
+
+void RTTTLLedcPool::unreserveTimer(ledc_timer_t timer) {
+  if (timer >= LEDC_TIMER_MAX) {
+    return;
+  }
+  portENTER_CRITICAL(&lock);
+  timers[timer].reserved = false;
+  // whoever had it may have left it at any setting
+  timers[timer].setting = RTTTLTimerSetting();
+  timers[timer].configured = false;
+  portEXIT_CRITICAL(&lock);
+}
+
+ledc_channel_t RTTTLLedcPool::takeChannel() {
+  ledc_channel_t channel = RTTTL_LEDC_CHANNEL_AUTO;
+  portENTER_CRITICAL(&lock);
+  for (int i = 0; i < LEDC_CHANNEL_MAX; i++) {
+    if (!channels[i]) {
+      channels[i] = true;
+      channel = (ledc_channel_t)i;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&lock);
+  return channel;
+}
+
+int RTTTLLedcPool::freeTimer() {
+  // prefer a timer nobody has touched to keep stale settings for sharing
+  int found = -1;
+  for (int i = 0; i < LEDC_TIMER_MAX; i++) {
+    if (timers[i].reserved || timers[i].pending || timers[i].users != 0) {
+      continue;
+    }
+    if (found < 0 || (timers[found].setting.resolution != 0 && timers[i].setting.resolution == 0)) {
+      found = i;
+    }
+  }
+  return found;
+}
+
+void RTTTLLedcPool::start(ledc_timer_t timer, const RTTTLTimerSetting &setting, ledc_clk_src_t source,
+                          bool fresh) {
+  if (fresh) {
+    // the first use of a timer goes through the full driver setup
+    ledc_timer_config_t config = {};
+    config.speed_mode = LEDC_LOW_SPEED_MODE;
+    config.duty_resolution = LEDC_TIMER_10_BIT;
+    config.timer_num = timer;
+    config.freq_hz = 2093;
+    config.clk_cfg = LEDC_AUTO_CLK;
+    ledc_timer_config(&config);
+  } else {
+    ledc_timer_resume(LEDC_LOW_SPEED_MODE, timer);
+  }
+  ledc_timer_set(LEDC_LOW_SPEED_MODE, timer, setting.divider, setting.resolution, source);
+  settle(timer);
+}
+
+void RTTTLLedcPool::settle(ledc_timer_t timer) {
+  portENTER_CRITICAL(&lock);
+  timers[timer].pending = false;
+  portEXIT_CRITICAL(&lock);
+}
+
+ledc_timer_t RTTTLLedcPool::takeTimer(const RTTTLTimerSetting &setting, ledc_clk_src_t source) {
+  int found = -1;
+  bool starting = false;
+  bool fresh = false;
+
+  portENTER_CRITICAL(&lock);
+  for (int i = 0; i < LEDC_TIMER_MAX; i++) {
+    Timer &t = timers[i];
+    if (!t.reserved && !t.exclusive && !t.pending && t.setting.resolution != 0 && same(t.setting, setting)) {
+      found = i;
+      break;
+    }
+  }
+  if (found < 0) {
+    found = freeTimer();
+  }
+  if (found >= 0) {
+    Timer &t = timers[found];
+    // joining a running timer needs no driver call
+    starting = t.users++ == 0;
+    fresh = !t.configured;
+    t.pending = starting;
+    t.configured = true;
+    t.setting = setting;
+  }
+  portEXIT_CRITICAL(&lock);
+
+  if (found < 0) {
+    return RTTTL_LEDC_TIMER_AUTO;
+  }
+  if (starting) {
+    start((ledc_timer_t)found, setting, source, fresh);
+  }
+  return (ledc_timer_t)found;
+}
+
+ledc_timer_t RTTTLLedcPool::ownTimer(ledc_timer_t timer, ledc_clk_src_t source) {
+  int found = -1;
+  bool moved = false;
+  bool fresh = false;
+  RTTTLTimerSetting setting;
+
+  if (timer >= LEDC_TIMER_MAX) {
+    return RTTTL_LEDC_TIMER_AUTO;
+  }
+  portENTER_CRITICAL(&lock);
+  if (timers[timer].users == 1) {
+    timers[timer].exclusive = true;
+    found = timer;
+  } else {
+    found = freeTimer();
+    if (found >= 0) {
+      Timer &t = timers[found];
+      setting = timers[timer].setting;
+      moved = true;
+      fresh = !t.configured;
+      t.pending = true;
+      t.configured = true;
+      t.setting = setting;
+      t.exclusive = true;
+      t.users = 1;
+      timers[timer].users--;
+    }
+  }
+  portEXIT_CRITICAL(&lock);
+
+  if (found < 0) {
+    return RTTTL_LEDC_TIMER_AUTO;
+  }
+  if (moved) {
+    start((ledc_timer_t)found, setting, source, fresh);
+  }
+  return (ledc_timer_t)found;
+}
+
+void RTTTLLedcPool::giveTimer(ledc_timer_t timer) {
+  bool stopping = false;
+
+  if (timer >= LEDC_TIMER_MAX) {
+    return;
+  }
+  portENTER_CRITICAL(&lock);
+  Timer &t = timers[timer];
+  if (t.users > 0 && --t.users == 0) {
+    if (t.exclusive) {
+      // its pitch was moved away from the setting it was taken with
+      t.setting = RTTTLTimerSetting();
+      t.exclusive = false;
+    }
+    // nobody takes it again before it is paused
+    t.pending = stopping = true;
+  }
+  portEXIT_CRITICAL(&lock);
+
+  if (stopping) {
+    // a paused timer keeps its setting for the next player in tune with it
+    ledc_timer_pause(LEDC_LOW_SPEED_MODE, timer);
+    settle(timer);
+  }
+}
+
+uint8_t RTTTLLedcPool::timersInUse() {
+  uint8_t count = 0;
+  portENTER_CRITICAL(&lock);
+  for (int i = 0; i < LEDC_TIMER_MAX; i++) {
+    if (timers[i].users != 0) count++;
+  }
+  portEXIT_CRITICAL(&lock);
+  return count;
+}
@@ -0,0 +1,72 @@
+#ifndef RTTTLLedcPool_h
+#define RTTTLLedcPool_h
+
+#include <driver/ledc.h>
+#include <freertos/FreeRTOS.h>
+
+#include "RTTTLPitch.h"
+
+// Pass these to the player or RTTTLLedcOutput to have the channel or the
+// timer handed out by RTTTLLedcPool instead of fixing it.
+#define RTTTL_LEDC_CHANNEL_AUTO LEDC_CHANNEL_MAX
+#define RTTTL_LEDC_TIMER_AUTO   LEDC_TIMER_MAX
+
+// Hands out the low speed LEDC channels and timers of the chip to players.
+// A channel is held from begin() to end(). A timer is only held while a note
+// sounds, and players sounding the same timer setting share one, so silent
+// players and players in unison cost no timer of their own. A player moves to
+// a timer of its own when vibrato or a glide has to change its pitch.
+//
+// The pool only decides under its spinlock. The driver calls that follow run
+// outside it, with the timer marked pending so nobody joins or takes it until
+// they are done; a player that finds only pending timers plays a silent note.
+//
+// Channels and timers given to a player explicitly are reserved when it
+// begins. Anything else using LEDC, like a backlight, has to reserve its
+// channel and timer here before players start.
+class RTTTLLedcPool {
+
+private:
+  struct Timer {
+    RTTTLTimerSetting setting;
+    uint8_t users;
+    bool reserved;   // not ours to hand out
+    bool exclusive;  // its pitch is moving, nobody may join
+    bool configured;
+    bool pending;    // driver calls on it are under way outside the lock
+  };
+
+  static Timer timers[LEDC_TIMER_MAX];
+  static bool channels[LEDC_CHANNEL_MAX];
+  static portMUX_TYPE lock;
+
+  static bool same(const RTTTLTimerSetting &a, const RTTTLTimerSetting &b);
+  static int freeTimer();
+  static void start(ledc_timer_t timer, const RTTTLTimerSetting &setting, ledc_clk_src_t source, bool fresh);
+  static void settle(ledc_timer_t timer);
+
+public:
+  // Keeps a channel or timer out of the pool. Returns false if it is already
+  // reserved or handed out.
+  static bool reserveChannel(ledc_channel_t channel);
+  static bool reserveTimer(ledc_timer_t timer);
+  static void unreserveChannel(ledc_channel_t channel);
+  static void unreserveTimer(ledc_timer_t timer);
+
+  // Returns a free channel, or RTTTL_LEDC_CHANNEL_AUTO if there is none.
+  static ledc_channel_t takeChannel();
+  static void giveChannel(ledc_channel_t channel) { unreserveChannel(channel); }
+
+  // Returns a running timer with the same setting, or a free one set to it,
+  // or RTTTL_LEDC_TIMER_AUTO if every timer is busy with other pitches.
+  static ledc_timer_t takeTimer(const RTTTLTimerSetting &setting, ledc_clk_src_t source);
+  // Makes sure the caller is the only user of its timer, moving it to a free
+  // timer with the same setting if it shares one. Returns the timer to use,
+  // or RTTTL_LEDC_TIMER_AUTO if it shares and no timer is free.
+  static ledc_timer_t ownTimer(ledc_timer_t timer, ledc_clk_src_t source);
+  static void giveTimer(ledc_timer_t timer);
+  // Number of timers handed out right now, for diagnostics.
+  static uint8_t timersInUse();
+};
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * Music Macro Language front-end for the RTTTL player.
+ */
+
+#include "RTTTLMML.h"
+
+// semitones of c, d, e, f, g, a and b
+static const int8_t scale[7] = { 0, 2, 4, 5, 7, 9, 11 };
+
+bool RTTTLMMLParser::load(const char *song) {
+  songStart = nullptr;
+  if (song == nullptr) {
+    return false;
+  }
+  if (lower(song[0]) == 'm' && lower(song[1]) == 'm' && lower(song[2]) == 'l' && song[3] == '@') {
+    song += 4;
+  }
+  songStart = song;
+  rewind();
+  return true;
+}
+
+void RTTTLMMLParser::rewind() {
+  state = State();
+  state.buffer = songStart;
+}
+
+void RTTTLMMLParser::describe(RTTTLSongInfo &info) const {
+  // what the commands before the first note left
+  info.defaultDuration = state.length;
+  info.defaultOctave = state.octave;
+  info.bpm = state.tempo;
+}
+
+int RTTTLMMLParser::number(bool &found) {
+  int num = 0;
+  found = false;
+  while (*state.buffer >= '0' && *state.buffer <= '9') {
+    num = (num * 10) + (*state.buffer++ - '0');
+    found = true;
+  }
+  return num;
+}
+
+bool RTTTLMMLParser::parse(RTTTLNote &note) {
+  bool found;
+
+  if (state.buffer == nullptr) {
+    return false;
+  }
+
+  while (true) {
+    char c = lower(*state.buffer);
+    if (c == '\0' || c == ',' || c == ';') {
+      return false;
+    }
+    state.buffer++;
+
+    int semitone = -1;
+    bool rest = false;
+    switch (c) {
+      case 'c': case 'd': case 'e': case 'f': case 'g': case 'a': case 'b':
+        semitone = scale[(c - 'a' + 5) % 7];
+        while (*state.buffer == '+' || *state.buffer == '#' || *state.buffer == '-') {
+          semitone += *state.buffer++ == '-' ? -1 : 1;
+        }
+        break;
+      case 'r':
+      case 'p':
+        rest = true;
+        break;
+      case 'n': {
+        int num = number(found);
+        // n0 is c in octave 0
+        note.frequency = num > 0 ? frequency(num, 0) : 0;
+        note.attenuation = RTTTL_NOTE_VOLUME_MAX - state.volume;
+        note.gate = state.gate;
+        note.duration = 240000L / (state.tempo * state.length);
+        return true;
+      }
+      case 'o': {
+        int num = number(found);
+        if (found && num <= 8) state.octave = num;
+        continue;
+      }
+      case '<':
+        if (state.octave > 0) state.octave--;
+        continue;
+      case '>':
+        if (state.octave < 8) state.octave++;
+        continue;
+      case 'l': {
+        int num = number(found);
+        if (num > 0 && num <= 64) state.length = num;
+        state.dots = 0;
+        while (*state.buffer == '.') {
+          state.dots++;
+          state.buffer++;
+        }
+        continue;
+      }
+      case 't': {
+        int num = number(found);
+        if (num > 0) state.tempo = num;
+        continue;
+      }
+      case 'v': {
+        int num = number(found);
+        state.volume = num < RTTTL_NOTE_VOLUME_MAX ? num : RTTTL_NOTE_VOLUME_MAX;
+        continue;
+      }
+      case 'q': {
+        int num = number(found);
+        if (num >= 1 && num <= 8) state.gate = num == 8 ? RTTTL_STYLE_CONTINUOUS : num * 100 / 8;
+        continue;
+      }
+      default:
+        // spaces, stray ties and anything this front-end does not know
+        continue;
+    }
+
+    int length = number(found);
+    uint8_t dots = 0;
+    if (!found || length <= 0) {
+      length = state.length;
+      dots = state.dots;
+    }
+    while (*state.buffer == '.') {
+      dots++;
+      state.buffer++;
+    }
+
+    // whole note is four beats at tempo quarter notes per minute
+    long part = 240000L / (state.tempo * length);
+    long duration = part;
+    while (dots--) {
+      part /= 2;
+      duration += part;
+    }
+
+    note.frequency = rest ? 0 : frequency(semitone, state.octave);
+    note.attenuation = RTTTL_NOTE_VOLUME_MAX - state.volume;
+    note.gate = state.gate;
+    note.duration = duration;
+    return true;
+  }
+}
+
+bool RTTTLMMLParser::nextNote(RTTTLNote &note) {
+  if (!parse(note)) {
+    return false;
+  }
+
+  // fold notes tied to the same pitch into one, anything else is played on its
+  // own by the next call
+  while (true) {
+    const char *next = state.buffer;
+    while (*next == ' ' || *next == '\t' || *next == '\r' || *next == '\n') {
+      next++;
+    }
+    if (*next != '&') {
+      return true;
+    }
+    State saved = state;
+    state.buffer = next + 1;
+    RTTTLNote tied;
+    if (!parse(tied) || tied.frequency != note.frequency) {
+      state = saved;
+      state.buffer = next + 1;
+      return true;
+    }
+    note.duration += tied.duration;
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef RTTTLMML_h
+#define RTTTLMML_h
+
+#include "RTTTLFrontEnd.h"
+#include "RTTTLParser.h"
+
+// Music Macro Language front-end. Reads notes c to b with +, # or - and an
+// optional length and dots, r or p rests, n note numbers, o, < and > for the
+// octave, l default length, t tempo, v volume (0-15), q gate (1-8 eighths of
+// the note) and & ties. Only the first channel is played: an "MML@" prefix is
+// skipped and the song ends at the first ',' or ';'. Starts at t120 l4 o4 v15.
+class RTTTLMMLParser : public RTTTLFrontEnd {
+
+private:
+  struct State {
+    const char * buffer = nullptr;
+    int tempo = 120;
+    uint8_t length = 4;
+    uint8_t dots = 0;
+    int8_t octave = 4;
+    uint8_t volume = RTTTL_NOTE_VOLUME_MAX;
+    uint8_t gate = RTTTL_STYLE_CONTINUOUS;
+  };
+
+  const char * songStart = nullptr;
+  State state;
+
+  int number(bool &found);
+  bool parse(RTTTLNote &note);
+
+public:
+  bool load(const char *song) override;
+  bool nextNote(RTTTLNote &note) override;
+  void rewind() override;
+  void describe(RTTTLSongInfo &info) const override;
+};
+
+#endif
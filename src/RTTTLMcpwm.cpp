@@ -0,0 +1,124 @@
+/*
+ * MCPWM output for the RTTTL player.
+ */
+
+#include "RTTTLMcpwm.h"
+
+#if RTTTL_MCPWM_SUPPORTED
+
+// the period register holds ticks - 1 in 16 bits
+#define RTTTL_MCPWM_PERIOD_MAX 65535
+// a few ticks per period still give a square wave, just with coarse volume
+#define RTTTL_MCPWM_PERIOD_MIN 8
+
+RTTTLMcpwmOutput::RTTTLMcpwmOutput(const gpio_num_t pin, const int group) {
+  this->pin = pin;
+  this->group = group;
+}
+
+RTTTLMcpwmOutput::~RTTTLMcpwmOutput() {
+  end();
+}
+
+bool RTTTLMcpwmOutput::begin() {
+  if (timer != nullptr) {
+    return true;
+  }
+
+  mcpwm_timer_config_t timerConfig = {};
+  timerConfig.group_id = group;
+  timerConfig.clk_src = MCPWM_TIMER_CLK_SRC_DEFAULT;
+  timerConfig.resolution_hz = RTTTL_MCPWM_RESOLUTION;
+  timerConfig.count_mode = MCPWM_TIMER_COUNT_MODE_UP;
+  timerConfig.period_ticks = RTTTL_MCPWM_RESOLUTION / 1000;
+  // a new period only starts once the running one is over
+  timerConfig.flags.update_period_on_empty = true;
+  if (mcpwm_new_timer(&timerConfig, &timer) != ESP_OK) {
+    timer = nullptr;
+    return false;
+  }
+  period = timerConfig.period_ticks;
+
+  mcpwm_operator_config_t operConfig = {};
+  operConfig.group_id = group;
+  mcpwm_comparator_config_t compareConfig = {};
+  compareConfig.flags.update_cmp_on_tez = true;
+  mcpwm_generator_config_t generatorConfig = {};
+  generatorConfig.gen_gpio_num = pin;
+  if (mcpwm_new_operator(&operConfig, &oper) != ESP_OK ||
+      mcpwm_operator_connect_timer(oper, timer) != ESP_OK ||
+      mcpwm_new_comparator(oper, &compareConfig, &comparator) != ESP_OK ||
+      mcpwm_new_generator(oper, &generatorConfig, &generator) != ESP_OK) {
+    end();
+    return false;
+  }
+
+  // high from the start of the period until the compare value
+  mcpwm_generator_set_action_on_timer_event(generator,
+      MCPWM_GEN_TIMER_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, MCPWM_TIMER_EVENT_EMPTY, MCPWM_GEN_ACTION_HIGH));
+  mcpwm_generator_set_action_on_compare_event(generator,
+      MCPWM_GEN_COMPARE_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, comparator, MCPWM_GEN_ACTION_LOW));
+  duty = 0;
+  writeCompare();
+
+  if (mcpwm_timer_enable(timer) != ESP_OK ||
+      mcpwm_timer_start_stop(timer, MCPWM_TIMER_START_NO_STOP) != ESP_OK) {
+    end();
+    return false;
+  }
+  return true;
+}
+
+void RTTTLMcpwmOutput::end() {
+  if (timer == nullptr) {
+    return;
+  }
+  mcpwm_timer_start_stop(timer, MCPWM_TIMER_STOP_EMPTY);
+  mcpwm_timer_disable(timer);
+  if (generator != nullptr) mcpwm_del_generator(generator);
+  if (comparator != nullptr) mcpwm_del_comparator(comparator);
+  if (oper != nullptr) mcpwm_del_operator(oper);
+  mcpwm_del_timer(timer);
+  generator = nullptr;
+  comparator = nullptr;
+  oper = nullptr;
+  timer = nullptr;
+  gpio_reset_pin(pin);
+}
+
+bool RTTTLMcpwmOutput::tone(uint16_t frequency) {
+  uint32_t ticks = frequency ? (RTTTL_MCPWM_RESOLUTION + frequency / 2) / frequency : 0;
+  if (ticks < RTTTL_MCPWM_PERIOD_MIN || ticks > RTTTL_MCPWM_PERIOD_MAX) {
+    return false;
+  }
+  retune(frequency);
+  return true;
+}
+
+void RTTTLMcpwmOutput::retune(uint32_t frequency) {
+  uint32_t ticks = frequency ? (RTTTL_MCPWM_RESOLUTION + frequency / 2) / frequency : RTTTL_MCPWM_PERIOD_MAX;
+  if (ticks < RTTTL_MCPWM_PERIOD_MIN) ticks = RTTTL_MCPWM_PERIOD_MIN;
+  if (ticks > RTTTL_MCPWM_PERIOD_MAX) ticks = RTTTL_MCPWM_PERIOD_MAX;
+  period = ticks;
+  mcpwm_timer_set_period(timer, period);
+  // the duty is a share of the period, so it follows the new one
+  writeCompare();
+}
+
+void RTTTLMcpwmOutput::setDuty(uint32_t duty) {
+  this->duty = duty;
+  writeCompare();
+}
+
+void RTTTLMcpwmOutput::writeCompare() {
+  uint32_t compare = ((uint64_t)period * duty) >> 16;
+  if (compare == 0) {
+    // a compare value of 0 meets the start of the period, hold the pin low
+    mcpwm_generator_set_force_level(generator, 0, true);
+    return;
+  }
+  mcpwm_comparator_set_compare_value(comparator, compare);
+  mcpwm_generator_set_force_level(generator, -1, true);
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef RTTTLMcpwm_h
+#define RTTTLMcpwm_h
+
+#include <sdkconfig.h>
+#include <esp_idf_version.h>
+#include <soc/soc_caps.h>
+
+// Changing the period of a running timer needs the MCPWM driver of ESP-IDF
+// 5.1.
+#if SOC_MCPWM_SUPPORTED && ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#define RTTTL_MCPWM_SUPPORTED 1
+#else
+#define RTTTL_MCPWM_SUPPORTED 0
+#endif
+
+#if RTTTL_MCPWM_SUPPORTED
+
+#include <driver/gpio.h>
+#include <driver/mcpwm_prelude.h>
+
+#include "RTTTLOutput.h"
+
+// Ticks per second of the MCPWM timer. The period register is 16 bits, so
+// the lowest note is RTTTL_MCPWM_RESOLUTION / 65535 Hz, and a period is
+// rounded to a whole tick, which is off by less than 5 cents up to 5 kHz at
+// the default.
+#ifndef RTTTL_MCPWM_RESOLUTION
+#define RTTTL_MCPWM_RESOLUTION 1000000
+#endif
+
+// Plays from an MCPWM timer, one operator, comparator and generator, for
+// boards whose LEDC timers are all in use. A note costs one period and one
+// compare value write, both latched at the end of the running period so the
+// wave never glitches. Plays from 16 Hz to RTTTL_MCPWM_RESOLUTION / 8 Hz,
+// 125 kHz at the default. Duty is in 1/65536 of the period; there is no fade
+// hardware, so envelope ramps jump to each level. Needs ESP-IDF 5.1.
+class RTTTLMcpwmOutput : public RTTTLOutput {
+
+private:
+  gpio_num_t pin;
+  int group;
+  mcpwm_timer_handle_t timer = nullptr;
+  mcpwm_oper_handle_t oper = nullptr;
+  mcpwm_cmpr_handle_t comparator = nullptr;
+  mcpwm_gen_handle_t generator = nullptr;
+  uint32_t period = 0; // ticks
+  uint32_t duty = 0;
+
+  void writeCompare();
+
+public:
+  RTTTLMcpwmOutput(const gpio_num_t pin, const int group = 0);
+  ~RTTTLMcpwmOutput();
+
+  bool begin() override;
+  void end() override;
+  bool tone(uint16_t frequency) override;
+  void retune(uint32_t frequency) override;
+  uint32_t fullScale() const override { return 1UL << 16; }
+  void setDuty(uint32_t duty) override;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Nokia Composer front-end for the RTTTL player.
+ */
+
+#include "RTTTLNokia.h"
+
+// semitones of c, d, e, f, g, a and b
+static const int8_t scale[7] = { 0, 2, 4, 5, 7, 9, 11 };
+
+bool RTTTLNokiaParser::load(const char *song) {
+  buffer = songStart = song;
+  return song != nullptr;
+}
+
+bool RTTTLNokiaParser::nextNote(RTTTLNote &note) {
+  if (buffer == nullptr) {
+    return false;
+  }
+
+  while (*buffer == ' ' || *buffer == '\t' || *buffer == '\r' || *buffer == '\n') {
+    buffer++;
+  }
+  if (*buffer == '\0') {
+    return false;
+  }
+
+  int length = 0;
+  while (*buffer >= '0' && *buffer <= '9') {
+    length = (length * 10) + (*buffer++ - '0');
+  }
+  if (length <= 0) length = 4;
+
+  long duration = 240000L / (tempo * length);
+  if (*buffer == '.') {
+    duration += duration / 2;
+    buffer++;
+  }
+
+  int semitone = 0;
+  if (*buffer == '#') {
+    semitone++;
+    buffer++;
+  }
+
+  char c = lower(*buffer);
+  note.frequency = 0;
+  if (c >= 'a' && c <= 'g') {
+    buffer++;
+    int octave = 1;
+    if (*buffer >= '1' && *buffer <= '9') {
+      octave = *buffer++ - '0';
+    }
+    // octave 1 is RTTTL octave 5, with a at 880 Hz
+    note.frequency = frequency(scale[(c - 'a' + 5) % 7] + semitone, octave + 4);
+  } else if (*buffer != '\0') {
+    buffer++; // '-' rest, or something unknown played as one
+  }
+
+  // skip to the next token
+  while (*buffer != '\0' && *buffer != ' ' && *buffer != '\t' && *buffer != '\r' && *buffer != '\n') {
+    buffer++;
+  }
+
+  note.attenuation = 0;
+  note.gate = RTTTL_STYLE_CONTINUOUS;
+  note.duration = duration;
+  return true;
+}
@@ -0,0 +1,28 @@
+#ifndef RTTTLNokia_h
+#define RTTTLNokia_h
+
+#include "RTTTLFrontEnd.h"
+#include "RTTTLParser.h"
+
+// Nokia Composer front-end. Reads the space separated notes typed into the
+// composer of old Nokia phones, like "8#f2 4.a1 16-": a length, an optional dot
+// and sharp, then a note with its octave (1 to 3) or '-' for a rest. The
+// composer keeps the tempo apart from the notes, so it is given here.
+class RTTTLNokiaParser : public RTTTLFrontEnd {
+
+private:
+  const char * buffer = nullptr;
+  const char * songStart = nullptr;
+  int tempo = 120;
+
+public:
+  RTTTLNokiaParser(int bpm = 120) { setTempo(bpm); }
+  void setTempo(int bpm) { if (bpm > 0) tempo = bpm; }
+
+  bool load(const char *song) override;
+  bool nextNote(RTTTLNote &note) override;
+  void rewind() override { buffer = songStart; }
+  void describe(RTTTLSongInfo &info) const override { info.bpm = tempo; }
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef RTTTLOutput_h
+#define RTTTLOutput_h
+
+#include <stdint.h>
+
+// Where the player's square wave comes out. The playback task is the only
+// caller once the player has started, so an output needs no locking of its
+// own. See RTTTLLedc.h, RTTTLMcpwm.h and RTTTLSdm.h for the ones that come
+// with the library.
+class RTTTLOutput {
+
+public:
+  virtual ~RTTTLOutput() { }
+
+  // Claims the peripheral and the pin, end() gives them back. Called by the
+  // player's own begin() and end().
+  virtual bool begin() = 0;
+  virtual void end() = 0;
+
+  // Called with every frequency of a song when it is loaded, after clear(),
+  // so the work of tone() can be done ahead of time.
+  virtual void clear() { }
+  virtual void prepare(uint16_t frequency) { (void)frequency; }
+
+  // Sets up the output for a new note. Returns false if it cannot make the
+  // frequency, the note then stays silent.
+  virtual bool tone(uint16_t frequency) = 0;
+  // Moves the pitch of the current note for glides and vibrato, in Hz. Must
+  // not change fullScale().
+  virtual void retune(uint32_t frequency) = 0;
+
+  // Duty that keeps the output high for the whole period after the last
+  // tone(). Half of it is the loudest.
+  virtual uint32_t fullScale() const = 0;
+  // Sets the duty at once, stopping a fade that is still running.
+  virtual void setDuty(uint32_t duty) = 0;
+  // Called whenever the player goes quiet, between notes and when a song
+  // ends, with the duty already at 0. Shared hardware can be handed back
+  // here; tone() comes again before anything sounds.
+  virtual void release() { }
+  // Ramps the duty over ms without the CPU. Returns false if the output has
+  // no hardware for it, the player then sets the duty at once.
+  virtual bool fade(uint32_t duty, uint32_t ms) {
+    (void)duty;
+    (void)ms;
+    return false;
+  }
+};
+
+#endif
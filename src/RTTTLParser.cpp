@@ -0,0 +1,292 @@
+/*
+ * RTTTL text parser, shared by the ESP32 player and the host tools.
+ * ported from https://github.com/end2endzone/NonBlockingRTTTL
+ */
+
+#include "RTTTLParser.h"
+
+static const uint16_t notes[49] = { 0,
+  NOTE_C4, NOTE_CS4, NOTE_D4, NOTE_DS4, NOTE_E4, NOTE_F4, NOTE_FS4, NOTE_G4, NOTE_GS4, NOTE_A4, NOTE_AS4, NOTE_B4,
+  NOTE_C5, NOTE_CS5, NOTE_D5, NOTE_DS5, NOTE_E5, NOTE_F5, NOTE_FS5, NOTE_G5, NOTE_GS5, NOTE_A5, NOTE_AS5, NOTE_B5,
+  NOTE_C6, NOTE_CS6, NOTE_D6, NOTE_DS6, NOTE_E6, NOTE_F6, NOTE_FS6, NOTE_G6, NOTE_GS6, NOTE_A6, NOTE_AS6, NOTE_B6,
+  NOTE_C7, NOTE_CS7, NOTE_D7, NOTE_DS7, NOTE_E7, NOTE_F7, NOTE_FS7, NOTE_G7, NOTE_GS7, NOTE_A7, NOTE_AS7, NOTE_B7
+};
+
+bool RTTTLParser::style(char c, uint8_t &gate) {
+  switch (lower(c)) {
+    case 's':
+      gate = RTTTL_STYLE_STACCATO;
+      return true;
+    case 'n':
+      gate = RTTTL_STYLE_NATURAL;
+      return true;
+    case 'c':
+      gate = RTTTL_STYLE_CONTINUOUS;
+      return true;
+    default:
+      return false;
+  }
+}
+
+void RTTTLParser::skipSpaces() {
+  while (*buffer == ' ' || *buffer == '\t' || *buffer == '\r' || *buffer == '\n') {
+    buffer++;
+  }
+}
+
+int RTTTLParser::number() {
+  int num = 0;
+  skipSpaces();
+  while (isdigit(*buffer)) {
+    num = (num * 10) + (*buffer++ - '0');
+  }
+  skipSpaces();
+  return num;
+}
+
+bool RTTTLParser::load(const char *song) {
+  buffer = nullptr;
+  songStart = nullptr;
+  name = nullptr;
+  nameLength = 0;
+  defaultDur = 4;
+  defaultOct = 6;
+  bpm = 63;
+  loopCount = 0;
+  startVolume = RTTTL_NOTE_VOLUME_MAX;
+  startGate = RTTTL_STYLE_CONTINUOUS;
+
+  if (song == nullptr) {
+    return false;
+  }
+
+  // format: name:key=value,key=value,...:notes
+  buffer = song;
+  while (*buffer != ':') { // ignore name
+    if (*buffer == '\0') {
+      buffer = nullptr;
+      return false;
+    }
+    buffer++;
+  }
+  name = song;
+  nameLength = buffer - song;
+  buffer++; // skip ':'
+
+  // the keys can come in any order, unknown ones are skipped; the header ends
+  // at the first token that is not key=value, so name:notes has no header
+  while (true) {
+    skipSpaces();
+    if (*buffer == ':' || *buffer == '\0') {
+      break;
+    }
+    const char *equals = buffer + 1;
+    while (*equals == ' ' || *equals == '\t' || *equals == '\r' || *equals == '\n') {
+      equals++;
+    }
+    if (*equals != '=') {
+      break;
+    }
+    char key = lower(*buffer);
+    buffer = equals + 1;
+    skipSpaces();
+
+    switch (key) {
+      case 'd': {
+        int num = number();
+        // 0 or anything past the byte it is kept in would divide by zero
+        if (num > 0 && num <= 255) defaultDur = num;
+        break;
+      }
+      case 'o': {
+        int num = number();
+        if (num >= 3 && num <= 7) defaultOct = num;
+        break;
+      }
+      case 'b': {
+        int num = number();
+        if (num > 0) bpm = num;
+        break;
+      }
+      case 'l': {
+        int num = number();
+        loopCount = num < RTTTL_LOOP_FOREVER ? num : RTTTL_LOOP_FOREVER;
+        break;
+      }
+      case 'v': {
+        int num = number();
+        startVolume = num < RTTTL_NOTE_VOLUME_MAX ? num : RTTTL_NOTE_VOLUME_MAX;
+        break;
+      }
+      case 's':
+        if (style(*buffer, startGate)) buffer++;
+        break;
+    }
+
+    // skip whatever is left of the value
+    while (*buffer != ',' && *buffer != ':' && *buffer != '\0') {
+      buffer++;
+    }
+    if (*buffer == ',') {
+      buffer++;
+    }
+  }
+  if (*buffer == ':') {
+    buffer++;
+  }
+
+  // BPM = number of quarter notes per minute
+  wholenote = (60 * 1000L / bpm) * 4;  // this is the time for whole note (in milliseconds)
+  songStart = buffer;
+  rewind();
+  return true;
+}
+
+void RTTTLParser::rewind() {
+  buffer = songStart;
+  volume = startVolume;
+  gate = startGate;
+}
+
+void RTTTLParser::describe(RTTTLSongInfo &info) const {
+  info.name = name;
+  info.nameLength = nameLength;
+  info.defaultDuration = defaultDur;
+  info.defaultOctave = defaultOct;
+  info.bpm = bpm;
+}
+
+bool RTTTLParser::nextNote(RTTTLNote &note) {
+  long duration;
+  uint8_t tone;
+  int scale;
+
+  if (buffer == nullptr) {
+    return false;
+  }
+
+  // style and volume changes apply to the notes after them
+  while (true) {
+    skipSpaces();
+    char c = lower(*buffer);
+    if (c == 's') {
+      buffer++;
+      skipSpaces();
+      if (style(*buffer, gate)) buffer++;
+    } else if (c == 'v') {
+      buffer++;
+      int num = number();
+      volume = num < RTTTL_NOTE_VOLUME_MAX ? num : RTTTL_NOTE_VOLUME_MAX;
+    } else if (c == ',') {
+      buffer++;
+      continue;
+    } else {
+      break;
+    }
+    skipSpaces();
+    if (*buffer == ',') buffer++;
+  }
+
+  if (*buffer == '\0') {
+    return false;
+  }
+
+  // first, get note duration, if available
+  int num = number();
+
+  if (num) duration = wholenote / num;
+  else duration = wholenote / defaultDur;  // we will need to check if we are a dotted note after
+
+  // now get the note
+  switch(lower(*buffer)) {
+    case 'c':
+      tone = 1;
+      break;
+    case 'd':
+      tone = 3;
+      break;
+    case 'e':
+      tone = 5;
+      break;
+    case 'f':
+      tone = 6;
+      break;
+    case 'g':
+      tone = 8;
+      break;
+    case 'a':
+      tone = 10;
+      break;
+    case 'b':
+    case 'h':
+      tone = 12;
+      break;
+    case 'p':
+    default:
+      tone = 0;
+  }
+  if (*buffer != '\0') buffer++;
+  skipSpaces();
+
+  // now, get optional '#' sharp
+  if (*buffer == '#') {
+    tone++;
+    buffer++;
+  }
+
+  // now, get optional '.' dotted note
+  if (*buffer == '.') {
+    duration += duration/2;
+    buffer++;
+  }
+
+  // now, get scale
+  if (isdigit(*buffer)) {
+    scale = *buffer - '0';
+    buffer++;
+  } else {
+    scale = defaultOct;
+  }
+
+  // the dot may also follow the octave
+  if (*buffer == '.') {
+    duration += duration/2;
+    buffer++;
+  }
+
+  scale += OCTAVE_OFFSET;
+
+  // the note table only covers octaves 4 to 7
+  if (scale < 4) scale = 4;
+  if (scale > 7) scale = 7;
+
+  skipSpaces();
+  if (*buffer == ',')
+    buffer++; // skip comma for next note (or we may be at the end)
+
+  // b# and h# run into c of the next octave, which the table holds except
+  // above octave 7
+  int index = (scale - 4) * 12 + tone;
+  if (index > 48) index = 48;
+  note.frequency = tone ? notes[index] : 0;
+  note.attenuation = RTTTL_NOTE_VOLUME_MAX - volume;
+  note.gate = gate;
+  note.duration = duration;
+  return true;
+}
+
+size_t RTTTLParser::compile(const char *song, RTTTLNote *out, size_t maxNotes) {
+  RTTTLParser parser;
+  return RTTTLFrontEnd::compile(parser, song, out, maxNotes);
+}
+
+bool RTTTLParser::compile(const char *song, RTTTLNote *out, size_t maxNotes, RTTTLSong &compiled,
+                          RTTTLSongInfo *info) {
+  RTTTLParser parser;
+  return RTTTLFrontEnd::compile(parser, song, out, maxNotes, compiled, info);
+}
+
+bool RTTTLParser::inspect(const char *song, RTTTLSongInfo &info) {
+  RTTTLParser parser;
+  return RTTTLFrontEnd::inspect(parser, song, info);
+}
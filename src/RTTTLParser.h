@@ -0,0 +1,208 @@
+#ifndef RTTTLParser_h
+#define RTTTLParser_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "RTTTLFrontEnd.h"
+
+#define NOTE_H   0
+#define NOTE_B0  31
+#define NOTE_C1  33
+#define NOTE_CS1 35
+#define NOTE_D1  37
+#define NOTE_DS1 39
+#define NOTE_E1  41
+#define NOTE_F1  44
+#define NOTE_FS1 46
+#define NOTE_G1  49
+#define NOTE_GS1 52
+#define NOTE_A1  55
+#define NOTE_AS1 58
+#define NOTE_B1  62
+#define NOTE_C2  65
+#define NOTE_CS2 69
+#define NOTE_D2  73
+#define NOTE_DS2 78
+#define NOTE_E2  82
+#define NOTE_F2  87
+#define NOTE_FS2 93
+#define NOTE_G2  98
+#define NOTE_GS2 104
+#define NOTE_A2  110
+#define NOTE_AS2 117
+#define NOTE_B2  123
+#define NOTE_C3  131
+#define NOTE_CS3 139
+#define NOTE_D3  147
+#define NOTE_DS3 156
+#define NOTE_E3  165
+#define NOTE_F3  175
+#define NOTE_FS3 185
+#define NOTE_G3  196
+#define NOTE_GS3 208
+#define NOTE_A3  220
+#define NOTE_AS3 233
+#define NOTE_B3  247
+#define NOTE_C4  262
+#define NOTE_CS4 277
+#define NOTE_D4  294
+#define NOTE_DS4 311
+#define NOTE_E4  330
+#define NOTE_F4  349
+#define NOTE_FS4 370
+#define NOTE_G4  392
+#define NOTE_GS4 415
+#define NOTE_A4  440
+#define NOTE_AS4 466
+#define NOTE_B4  494
+#define NOTE_C5  523
+#define NOTE_CS5 554
+#define NOTE_D5  587
+#define NOTE_DS5 622
+#define NOTE_E5  659
+#define NOTE_F5  698
+#define NOTE_FS5 740
+#define NOTE_G5  784
+#define NOTE_GS5 831
+#define NOTE_A5  880
+#define NOTE_AS5 932
+#define NOTE_B5  988
+#define NOTE_C6  1047
+#define NOTE_CS6 1109
+#define NOTE_D6  1175
+#define NOTE_DS6 1245
+#define NOTE_E6  1319
+#define NOTE_F6  1397
+#define NOTE_FS6 1480
+#define NOTE_G6  1568
+#define NOTE_GS6 1661
+#define NOTE_A6  1760
+#define NOTE_AS6 1865
+#define NOTE_B6  1976
+#define NOTE_C7  2093
+#define NOTE_CS7 2217
+#define NOTE_D7  2349
+#define NOTE_DS7 2489
+#define NOTE_E7  2637
+#define NOTE_F7  2794
+#define NOTE_FS7 2960
+#define NOTE_G7  3136
+#define NOTE_GS7 3322
+#define NOTE_A7  3520
+#define NOTE_AS7 3729
+#define NOTE_B7  3951
+#define NOTE_C8  4186
+#define NOTE_CS8 4435
+#define NOTE_D8  4699
+#define NOTE_DS8 4978
+
+#define OCTAVE_OFFSET 0
+
+// RTX extensions. RTX volumes go from 0 to RTTTL_NOTE_VOLUME_MAX and scale the
+// player volume; a loop count of RTTTL_LOOP_FOREVER never ends.
+#define RTTTL_NOTE_VOLUME_MAX 15
+#define RTTTL_LOOP_FOREVER    15
+
+// Part of each note that sounds in percent, the rest is silence.
+enum RTTTLStyle : uint8_t {
+  RTTTL_STYLE_CONTINUOUS = 0, // the whole note
+  RTTTL_STYLE_STACCATO = 50,
+  RTTTL_STYLE_NATURAL = 90
+};
+
+// A single note of a song. A frequency of 0 is a pause. The RTX fields fill
+// what would otherwise be padding, so a note still takes 8 bytes, and are 0
+// for plain RTTTL.
+struct RTTTLNote {
+  uint16_t frequency;
+  uint8_t attenuation; // RTX volume steps below RTTTL_NOTE_VOLUME_MAX
+  uint8_t gate;        // RTTTLStyle or any percent, 0 sounds the whole note
+  uint32_t duration;   // milliseconds
+};
+
+// A song compiled ahead of time into caller-provided storage.
+struct RTTTLSong {
+  const RTTTLNote * notes = nullptr;
+  size_t count = 0;
+  uint8_t loops = 0; // extra times the song is played after the first
+};
+
+// What inspect() finds out about a song in one pass, without playing it.
+struct RTTTLSongInfo {
+  const char * name = nullptr;  // points into the song text, not terminated
+  size_t nameLength = 0;
+  uint8_t defaultDuration = 0;  // header defaults, 0 if the format has none
+  uint8_t defaultOctave = 0;
+  uint16_t bpm = 0;             // tempo the song starts at
+  size_t notes = 0;             // pauses included
+  uint64_t duration = 0;        // one pass in microseconds, at the song's tempo
+  uint16_t lowest = 0;          // Hz, both 0 if the song is only pauses
+  uint16_t highest = 0;
+  uint8_t loops = 0;
+
+  void add(const RTTTLNote &note) {
+    notes++;
+    duration += note.duration * 1000ULL;
+    if (note.frequency != 0) {
+      if (lowest == 0 || note.frequency < lowest) lowest = note.frequency;
+      if (note.frequency > highest) highest = note.frequency;
+    }
+  }
+  // Length with every loop, UINT64_MAX if the song loops forever.
+  uint64_t total() const {
+    return loops >= RTTTL_LOOP_FOREVER ? UINT64_MAX : duration * (loops + 1);
+  }
+};
+
+// Parses RTTTL text one note at a time. Does not depend on any ESP32 API so it
+// can also be built on the host.
+//
+// Besides plain RTTTL it reads the RTX extensions: the header keys d, o, b,
+// l (loop count), s (style N, S or C) and v (volume 0-15) in any order, and
+// sN/vN tokens between notes that change the style or volume of the notes
+// after them. Spaces and upper case are accepted everywhere.
+class RTTTLParser : public RTTTLFrontEnd {
+
+private:
+  const char * buffer = nullptr;
+  const char * songStart = nullptr;
+  const char * name = nullptr;
+  size_t nameLength = 0;
+  uint8_t defaultDur = 4;
+  uint8_t defaultOct = 6;
+  int bpm = 63;
+  long wholenote = 0;
+  uint8_t loopCount = 0;
+  uint8_t startVolume = RTTTL_NOTE_VOLUME_MAX;
+  uint8_t startGate = RTTTL_STYLE_CONTINUOUS;
+  uint8_t volume = RTTTL_NOTE_VOLUME_MAX;
+  uint8_t gate = RTTTL_STYLE_CONTINUOUS;
+
+  static bool isdigit(char c) { return (c >= '0') and (c <= '9'); }
+  static bool style(char c, uint8_t &gate);
+  void skipSpaces();
+  int number();
+
+public:
+  bool load(const char *song) override;
+  bool nextNote(RTTTLNote &note) override;
+  bool available() const { return buffer != nullptr && *buffer != '\0'; }
+  void rewind() override;
+  uint8_t loops() const override { return loopCount; }
+  void describe(RTTTLSongInfo &info) const override;
+
+  // Parses the whole song into notes. Returns the number of notes in the song,
+  // which may be larger than maxNotes, or 0 if the song could not be parsed.
+  static size_t compile(const char *song, RTTTLNote *out, size_t maxNotes);
+  // Same, and fills in compiled with the notes and the loop count. Returns false
+  // if the song could not be parsed or did not fit.
+  // When info is given it is filled in from the same pass.
+  static bool compile(const char *song, RTTTLNote *out, size_t maxNotes, RTTTLSong &compiled,
+                      RTTTLSongInfo *info = nullptr);
+  // Name, header defaults, note count, length and pitch range of a song,
+  // without storing its notes. Returns false if it could not be parsed.
+  static bool inspect(const char *song, RTTTLSongInfo &info);
+};
+
+#endif
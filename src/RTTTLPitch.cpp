@@ -0,0 +1,87 @@
+/*
+ * LEDC clock and resolution planning for the RTTTL player.
+ */
+
+#include "RTTTLPitch.h"
+
+RTTTLPitch::RTTTLPitch(const uint32_t *clocks, uint8_t clockCount, uint8_t minResolution, uint8_t maxResolution) {
+  this->clocks = clocks;
+  this->clockCount = clockCount;
+  this->minResolution = minResolution;
+  this->maxResolution = maxResolution;
+}
+
+uint32_t RTTTLPitch::divider(uint32_t clockHz, uint32_t frequency, uint8_t resolution) {
+  if (frequency == 0) {
+    return RTTTL_DIVIDER_MAX;
+  }
+  uint64_t period = (uint64_t)frequency << resolution;
+  uint64_t divider = (((uint64_t)clockHz << 8) + period / 2) / period;
+  if (divider < RTTTL_DIVIDER_MIN) divider = RTTTL_DIVIDER_MIN;
+  if (divider > RTTTL_DIVIDER_MAX) divider = RTTTL_DIVIDER_MAX;
+  return divider;
+}
+
+uint32_t RTTTLPitch::actual(uint32_t clockHz, uint32_t divider, uint8_t resolution) {
+  uint64_t period = (uint64_t)divider << resolution;
+  return (uint32_t)((((uint64_t)clockHz * 1000) << 8) / period);
+}
+
+bool RTTTLPitch::plan(uint16_t frequency, RTTTLTimerSetting &setting) const {
+  uint64_t bestError = UINT64_MAX;
+
+  setting = RTTTLTimerSetting();
+  if (frequency == 0) {
+    return false;
+  }
+
+  for (uint8_t clock = 0; clock < clockCount; clock++) {
+    // the lowest resolution that keeps the divider in range has the largest
+    // divider and so the finest pitch steps
+    uint8_t resolution = minResolution;
+    while (resolution < maxResolution &&
+           ((uint64_t)clocks[clock] << 8) / ((uint64_t)frequency << resolution) > RTTTL_DIVIDER_MAX) {
+      resolution++;
+    }
+    uint64_t exact = ((uint64_t)clocks[clock] << 8) / ((uint64_t)frequency << resolution);
+    if (exact < RTTTL_DIVIDER_MIN || exact > RTTTL_DIVIDER_MAX) {
+      continue;
+    }
+
+    uint32_t div = divider(clocks[clock], frequency, resolution);
+    uint32_t made = actual(clocks[clock], div, resolution);
+    uint32_t wanted = frequency * 1000;
+    uint64_t error = made > wanted ? made - wanted : wanted - made;
+    if (error < bestError) {
+      bestError = error;
+      setting.divider = div;
+      setting.resolution = resolution;
+      setting.clock = clock;
+    }
+  }
+  return setting.resolution != 0;
+}
+
+void RTTTLPitch::add(uint16_t frequency) {
+  if (frequency == 0 || count >= RTTTL_PITCH_CACHE_SIZE) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (frequencies[i] == frequency) {
+      return;
+    }
+  }
+  frequencies[count] = frequency;
+  plan(frequency, settings[count]);
+  count++;
+}
+
+bool RTTTLPitch::lookup(uint16_t frequency, RTTTLTimerSetting &setting) const {
+  for (size_t i = 0; i < count; i++) {
+    if (frequencies[i] == frequency) {
+      setting = settings[i];
+      return setting.resolution != 0;
+    }
+  }
+  return plan(frequency, setting);
+}
@@ -0,0 +1,68 @@
+#ifndef RTTTLPitch_h
+#define RTTTLPitch_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fewest duty bits a note is played with, which sets how fine the volume
+// steps are. 10 matches the fixed resolution used before.
+#ifndef RTTTL_MIN_RESOLUTION
+#define RTTTL_MIN_RESOLUTION 10
+#endif
+
+// Number of distinct frequencies of a song whose timer settings are worked out
+// when the song is loaded. Others are worked out when they are played.
+#ifndef RTTTL_PITCH_CACHE_SIZE
+#define RTTTL_PITCH_CACHE_SIZE 32
+#endif
+
+// The LEDC timer divider is 10.8 fixed point and at least 1.
+#define RTTTL_DIVIDER_MIN 0x100
+#define RTTTL_DIVIDER_MAX 0x3FFFF
+
+// How to run the LEDC timer for one frequency.
+struct RTTTLTimerSetting {
+  uint32_t divider = 0;    // 10.8 fixed point
+  uint8_t resolution = 0;  // duty bits, 0 if the frequency cannot be made
+  uint8_t clock = 0;       // index into the clock list
+};
+
+// Picks the clock source and duty resolution that get closest to each
+// frequency. The divider only has 8 fractional bits, so the pitch error
+// shrinks as the divider grows: for every clock the lowest resolution that
+// still fits the divider is tried, but never less than the minimum that
+// keeps the volume steps fine enough.
+class RTTTLPitch {
+
+private:
+  const uint32_t * clocks = nullptr; // Hz
+  uint8_t clockCount = 0;
+  uint8_t minResolution = RTTTL_MIN_RESOLUTION;
+  uint8_t maxResolution = 14;
+  uint16_t frequencies[RTTTL_PITCH_CACHE_SIZE];
+  RTTTLTimerSetting settings[RTTTL_PITCH_CACHE_SIZE];
+  size_t count = 0;
+
+public:
+  RTTTLPitch() { }
+  RTTTLPitch(const uint32_t *clocks, uint8_t clockCount, uint8_t minResolution, uint8_t maxResolution);
+
+  // Forgets the settings worked out so far.
+  void clear() { count = 0; }
+  // Works out the setting for frequency ahead of time, if there is room.
+  void add(uint16_t frequency);
+  // Returns false if no clock and resolution can make the frequency.
+  bool lookup(uint16_t frequency, RTTTLTimerSetting &setting) const;
+
+  bool plan(uint16_t frequency, RTTTLTimerSetting &setting) const;
+  uint32_t clockHz(uint8_t clock) const { return clock < clockCount ? clocks[clock] : 0; }
+
+  // Divider for frequency at a fixed clock and resolution, clamped to what
+  // the timer takes. Used to move the pitch during a note without changing
+  // the resolution.
+  static uint32_t divider(uint32_t clockHz, uint32_t frequency, uint8_t resolution);
+  // Frequency the timer really runs at, in mHz.
+  static uint32_t actual(uint32_t clockHz, uint32_t divider, uint8_t resolution);
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef RTTTLProgress_h
+#define RTTTLProgress_h
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "RTTTLParser.h"
+
+// Where playback is. Times are song time at the song's own tempo, so a
+// setTempo() changes how fast they move but not the length.
+struct RTTTLPosition {
+  bool playing;
+  size_t index;       // note being played, pauses included, from 0 on every repeat
+  uint64_t elapsed;   // microseconds played since play(), repeats included
+  uint64_t length;    // microseconds of the whole song, UINT64_MAX if it loops forever
+  uint64_t pass;      // microseconds of one pass
+};
+
+// Snapshot of the playback position, written by the playback task at every
+// note and read from any task without locks. A sequence counter that is odd
+// while a note is published tells a reader to try again, so a read is a few
+// loads and never waits on the writer. The fields are 32 bit atomics so the
+// ESP32 reads and writes them in single instructions; inside a note the
+// reader fills in the time from the clock. Everything is inline.
+class RTTTLProgress {
+
+private:
+  std::atomic<uint32_t> sequence{0};
+  std::atomic<uint32_t> playing{0};
+  std::atomic<uint32_t> index{0};
+  std::atomic<uint32_t> songTime{0};   // ms where the note starts
+  std::atomic<uint32_t> noteTime{0};   // ms of the note at the song's tempo
+  std::atomic<uint32_t> playTime{0};   // ms of the note at the playback tempo
+  std::atomic<uint32_t> started{0};    // low bits of the clock when it was due
+  std::atomic<uint32_t> passTime{0};   // ms of one pass
+  std::atomic<uint32_t> loops{0};
+
+  void beginWrite() {
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  void endWrite() {
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+public:
+  // Writer side, the playback task only.
+
+  // Length of a newly loaded song, loops as in RTTTLSong.
+  void setLength(uint32_t ms, uint8_t loops) {
+    beginWrite();
+    passTime.store(ms, std::memory_order_relaxed);
+    this->loops.store(loops, std::memory_order_relaxed);
+    endWrite();
+  }
+  // A note became due at scheduled on the caller's clock in microseconds.
+  void publish(size_t index, uint32_t songTime, uint32_t noteTime, uint32_t playTime, int64_t scheduled) {
+    beginWrite();
+    playing.store(1, std::memory_order_relaxed);
+    this->index.store(index, std::memory_order_relaxed);
+    this->songTime.store(songTime, std::memory_order_relaxed);
+    this->noteTime.store(noteTime, std::memory_order_relaxed);
+    this->playTime.store(playTime, std::memory_order_relaxed);
+    started.store((uint32_t)scheduled, std::memory_order_relaxed);
+    endWrite();
+  }
+  void stop() {
+    beginWrite();
+    playing.store(0, std::memory_order_relaxed);
+    index.store(0, std::memory_order_relaxed);
+    songTime.store(0, std::memory_order_relaxed);
+    noteTime.store(0, std::memory_order_relaxed);
+    playTime.store(0, std::memory_order_relaxed);
+    endWrite();
+  }
+
+  // Reader side, any task. now is the clock publish() was given.
+  RTTTLPosition read(int64_t now) const {
+    RTTTLPosition position;
+    uint32_t before, from, note, play, start, passMs, repeats;
+
+    do {
+      before = sequence.load(std::memory_order_acquire);
+      position.playing = playing.load(std::memory_order_relaxed) != 0;
+      position.index = index.load(std::memory_order_relaxed);
+      from = songTime.load(std::memory_order_relaxed);
+      note = noteTime.load(std::memory_order_relaxed);
+      play = playTime.load(std::memory_order_relaxed);
+      start = started.load(std::memory_order_relaxed);
+      passMs = passTime.load(std::memory_order_relaxed);
+      repeats = loops.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) || sequence.load(std::memory_order_relaxed) != before);
+
+    // the clock wraps after 71 minutes, far longer than a note; a now taken
+    // just before the note was published comes out negative
+    int32_t since = (int32_t)((uint32_t)now - start);
+    uint64_t into = since > 0 ? since : 0;
+    if (into > play * 1000ULL) into = play * 1000ULL;
+    position.elapsed = from * 1000ULL + (play ? into * note / play : 0);
+    position.pass = passMs * 1000ULL;
+    position.length = repeats >= RTTTL_LOOP_FOREVER ? UINT64_MAX : position.pass * (repeats + 1);
+    return position;
+  }
+
+  // Share of the song played in per mille, songs looping forever count one
+  // pass.
+  static uint16_t perMille(const RTTTLPosition &position) {
+    if (!position.playing || position.pass == 0) {
+      return 0;
+    }
+    uint64_t done = position.elapsed;
+    uint64_t length = position.length;
+    if (length == UINT64_MAX) {
+      done %= position.pass;
+      length = position.pass;
+    }
+    return done >= length ? 1000 : (uint16_t)(done * 1000 / length);
+  }
+};
+
+#endif
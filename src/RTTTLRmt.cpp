@@ -0,0 +1,182 @@
+/*
+ * RMT output for the RTTTL player.
+ */
+
+#include "RTTTLRmt.h"
+
+#if RTTTL_RMT_SUPPORTED
+
+#include "RTTTLVolume.h"
+
+RTTTLRmt::RTTTLRmt(const gpio_num_t pin) {
+  this->pin = pin;
+}
+
+RTTTLRmt::~RTTTLRmt() {
+  end();
+}
+
+size_t RTTTLRmt::encode(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *data, size_t size,
+                        rmt_encode_state_t *state) {
+  Encoder *self = __containerof(encoder, Encoder, base);
+  rmt_encode_state_t session = RMT_ENCODING_RESET;
+  size_t written = 0;
+  (void)data;
+  (void)size;
+
+  // runs in the RMT interrupt whenever there is room in the channel memory
+  while (true) {
+    if (self->staged == 0) {
+      self->staged = self->symbols->encode(self->buffer, RTTTL_RMT_BLOCK_SYMBOLS);
+      if (self->staged == 0) {
+        *state = RMT_ENCODING_COMPLETE;
+        return written;
+      }
+    }
+    written += self->copy->encode(self->copy, channel, self->buffer, self->staged * sizeof(rmt_symbol_word_t),
+                                  &session);
+    if (session & RMT_ENCODING_COMPLETE) {
+      self->staged = 0;
+      self->copy->reset(self->copy);
+    }
+    if (session & RMT_ENCODING_MEM_FULL) {
+      *state = RMT_ENCODING_MEM_FULL;
+      return written;
+    }
+  }
+}
+
+esp_err_t RTTTLRmt::reset(rmt_encoder_t *encoder) {
+  Encoder *self = __containerof(encoder, Encoder, base);
+  self->staged = 0;
+  return self->copy->reset(self->copy);
+}
+
+esp_err_t RTTTLRmt::remove(rmt_encoder_t *encoder) {
+  Encoder *self = __containerof(encoder, Encoder, base);
+  return rmt_del_encoder(self->copy);
+}
+
+bool RTTTLRmt::transmitted(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *event, void *arg) {
+  (void)channel;
+  (void)event;
+  ((RTTTLRmt*)arg)->playing = false;
+  return false;
+}
+
+bool RTTTLRmt::begin() {
+  if (channel != nullptr) {
+    return true;
+  }
+
+  rmt_tx_channel_config_t config = {};
+  config.gpio_num = pin;
+  config.clk_src = RMT_CLK_SRC_DEFAULT;
+  config.resolution_hz = symbols.ticksPerSecond();
+  config.mem_block_symbols = RTTTL_RMT_BLOCK_SYMBOLS;
+  config.trans_queue_depth = 1;
+  if (rmt_new_tx_channel(&config, &channel) != ESP_OK) {
+    channel = nullptr;
+    return false;
+  }
+
+  rmt_copy_encoder_config_t copyConfig = {};
+  encoder.base.encode = encode;
+  encoder.base.reset = reset;
+  encoder.base.del = remove;
+  encoder.symbols = &symbols;
+  encoder.staged = 0;
+  if (rmt_new_copy_encoder(&copyConfig, &encoder.copy) != ESP_OK) {
+    rmt_del_channel(channel);
+    channel = nullptr;
+    return false;
+  }
+
+  rmt_tx_event_callbacks_t callbacks = {};
+  callbacks.on_trans_done = transmitted;
+  rmt_tx_register_event_callbacks(channel, &callbacks, this);
+  rmt_enable(channel);
+  return true;
+}
+
+void RTTTLRmt::end() {
+  if (channel == nullptr) {
+    return;
+  }
+  rmt_disable(channel);
+  playing = false;
+  rmt_del_encoder(&encoder.base);
+  rmt_del_channel(channel);
+  channel = nullptr;
+}
+
+bool RTTTLRmt::loadSong(const char *song, const int volume) {
+  if (playing) {
+    return false;
+  }
+  this->volume = volume;
+  return symbols.song().load(song);
+}
+
+bool RTTTLRmt::loadSong(const char *song, RTTTLFrontEnd &format, const int volume) {
+  if (playing) {
+    return false;
+  }
+  this->volume = volume;
+  return symbols.song().load(song, &format);
+}
+
+bool RTTTLRmt::loadSong(const RTTTLSong &song, const int volume) {
+  if (playing) {
+    return false;
+  }
+  this->volume = volume;
+  return symbols.song().load(song);
+}
+
+void RTTTLRmt::setTempo(const int percent) {
+  if (!playing) {
+    symbols.song().setTempo(percent);
+  }
+}
+
+bool RTTTLRmt::play() {
+  if (playing || !symbols.song().isLoaded() || !begin()) {
+    return false;
+  }
+
+  int level = volume;
+  if (level < 0) level = 0;
+  if (level > RTTTL_MAX_VOLUME) level = RTTTL_MAX_VOLUME;
+  symbols.setLevel(level * 100 / RTTTL_MAX_VOLUME);
+  symbols.start();
+
+  // the encoder pulls the notes itself, the payload is only a placeholder
+  rmt_transmit_config_t transmit = {};
+  transmit.flags.eot_level = 0;
+  playing = true;
+  if (rmt_transmit(channel, &encoder.base, &symbols, sizeof(symbols), &transmit) != ESP_OK) {
+    playing = false;
+    return false;
+  }
+  return true;
+}
+
+void RTTTLRmt::stop() {
+  if (channel == nullptr || !playing) {
+    return;
+  }
+  // disabling drops the transmission in progress
+  rmt_disable(channel);
+  playing = false;
+  rmt_enable(channel);
+}
+
+bool RTTTLRmt::waitUntilDone(int timeoutMs) {
+  if (channel == nullptr) {
+    return true;
+  }
+  return rmt_tx_wait_all_done(channel, timeoutMs) == ESP_OK;
+}
+
+#endif
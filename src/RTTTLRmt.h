@@ -0,0 +1,84 @@
+#ifndef RTTTLRmt_h
+#define RTTTLRmt_h
+
+#include <sdkconfig.h>
+#include <esp_idf_version.h>
+#include <soc/soc_caps.h>
+
+// The streaming encoder needs the RMT driver of ESP-IDF 5. It runs the parser
+// and sequencer, which live in flash, from the RMT interrupt, so it cannot be
+// used with CONFIG_RMT_ISR_IRAM_SAFE.
+#if SOC_RMT_SUPPORTED && ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0) && !CONFIG_RMT_ISR_IRAM_SAFE
+#define RTTTL_RMT_SUPPORTED 1
+#else
+#define RTTTL_RMT_SUPPORTED 0
+#endif
+
+#if RTTTL_RMT_SUPPORTED
+
+#include <driver/gpio.h>
+#include <driver/rmt_encoder.h>
+#include <driver/rmt_tx.h>
+
+#include <atomic>
+
+#include "RTTTLFrontEnd.h"
+#include "RTTTLParser.h"
+#include "RTTTLRmtEncoder.h"
+
+// Plays songs from the RMT peripheral instead of LEDC. The whole square wave
+// is encoded into RMT symbols by an encoder the RMT driver calls from its
+// interrupt whenever half of the channel memory has been sent, so no task has
+// to wake up at note edges; the CPU cost is one short interrupt per
+// RTTTL_RMT_BLOCK_SYMBOLS / 2 periods. Needs ESP-IDF 5.
+//
+// The encoder code is not in IRAM: the interrupt waits while the flash cache
+// is off, e.g. during flash writes, so CONFIG_RMT_ISR_IRAM_SAFE must stay off
+// and long flash writes can stall the sound.
+class RTTTLRmt {
+
+private:
+  struct Encoder {
+    rmt_encoder_t base;
+    rmt_encoder_handle_t copy;
+    RTTTLRmtEncoder *symbols;
+    uint32_t buffer[RTTTL_RMT_BLOCK_SYMBOLS];
+    size_t staged;
+  };
+
+  gpio_num_t pin;
+  RTTTLRmtEncoder symbols;
+  Encoder encoder = {};
+  rmt_channel_handle_t channel = nullptr;
+  std::atomic<bool> playing{false};
+  int volume = 10;
+
+  static size_t encode(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *data, size_t size,
+                       rmt_encode_state_t *state);
+  static esp_err_t reset(rmt_encoder_t *encoder);
+  static esp_err_t remove(rmt_encoder_t *encoder);
+  static bool transmitted(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *event, void *arg);
+
+public:
+  RTTTLRmt(const gpio_num_t pin);
+  ~RTTTLRmt();
+  // Sets up the RMT channel. play() calls it when needed.
+  bool begin();
+  void end();
+  // Songs are read while they play, so they have to stay valid until then.
+  // Call these only while stopped.
+  bool loadSong(const char *song, const int volume = 10);
+  bool loadSong(const char *song, RTTTLFrontEnd &format, const int volume = 10);
+  bool loadSong(const RTTTLSong &song, const int volume = 10);
+  void setTempo(const int percent);
+  bool play();
+  void stop();
+  bool isPlaying() const { return playing; }
+  // Returns false if the song is still playing after timeoutMs, -1 waits
+  // forever.
+  bool waitUntilDone(int timeoutMs = -1);
+};
+
+#endif
+
+#endif
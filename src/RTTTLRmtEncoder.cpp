@@ -0,0 +1,76 @@
+/*
+ * RMT symbol encoding of songs for the RTTTL player.
+ */
+
+#include "RTTTLRmtEncoder.h"
+
+void RTTTLRmtEncoder::start() {
+  sequencer.start(0);
+  position = soundEnd = noteEnd = 0;
+  songTime = 0;
+  accumulator = 0;
+  active = sequencer.isLoaded();
+}
+
+bool RTTTLRmtEncoder::nextNote() {
+  RTTTLNote note;
+
+  if (!sequencer.nextNote(note)) {
+    return false;
+  }
+
+  uint32_t length = note.duration;
+  if (note.gate != 0 && note.gate < 100) {
+    length = length * note.gate / 100;
+  }
+  uint64_t start = songTime * resolution / 1000;
+  songTime += note.duration;
+  noteEnd = songTime * resolution / 1000;
+  soundEnd = start + (uint64_t)length * resolution / 1000;
+
+  frequency = note.frequency >= minFrequency() && note.frequency <= resolution / 2 ? note.frequency : 0;
+  uint8_t volume = RTTTL_NOTE_VOLUME_MAX - (note.attenuation < RTTTL_NOTE_VOLUME_MAX ? note.attenuation : RTTTL_NOTE_VOLUME_MAX);
+  // the loudest a piezo gets is half of each period high
+  share = (uint32_t)32768 * level * volume / (100 * RTTTL_NOTE_VOLUME_MAX);
+  accumulator = 0;
+  return true;
+}
+
+size_t RTTTLRmtEncoder::encode(uint32_t *symbols, size_t max) {
+  size_t count = 0;
+
+  while (active && count < max) {
+    if (position >= noteEnd) {
+      if (!nextNote()) {
+        active = false;
+        break;
+      }
+      continue;
+    }
+
+    if (frequency != 0 && share != 0 && position < soundEnd) {
+      // whole ticks per period, carrying the fraction to the next one so the
+      // average pitch is exact
+      accumulator += resolution;
+      uint32_t ticks = accumulator / frequency;
+      accumulator %= frequency;
+      if (position + ticks <= soundEnd) {
+        uint32_t high = ((uint64_t)ticks * share) >> 16;
+        if (high == 0) high = 1;
+        symbols[count++] = symbol(high, true, ticks - high, false);
+        position += ticks;
+        continue;
+      }
+      // not enough time left for a whole period, the rest is quiet
+      soundEnd = position;
+    }
+
+    // quiet up to the end of the note, split into symbols that fit
+    uint64_t rest = noteEnd - position;
+    if (rest > 2 * RTTTL_RMT_DURATION_MAX) rest = 2 * RTTTL_RMT_DURATION_MAX;
+    if (rest < 2) rest = 2; // a 0 duration would end the transmission
+    symbols[count++] = symbol(rest - rest / 2, false, rest / 2, false);
+    position += rest;
+  }
+  return count;
+}
@@ -0,0 +1,70 @@
+#ifndef RTTTLRmtEncoder_h
+#define RTTTLRmtEncoder_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "RTTTLSequencer.h"
+
+// RMT ticks per second. Sets how finely note periods are placed: at 1 MHz a
+// period is off by at most 1 us and the average pitch is exact.
+#ifndef RTTTL_RMT_RESOLUTION
+#define RTTTL_RMT_RESOLUTION 1000000
+#endif
+
+// RMT symbols per channel memory block, the most RTTTLRmt encodes between two
+// refills. Here so host tools stage symbols the same way.
+#ifndef RTTTL_RMT_BLOCK_SYMBOLS
+#define RTTTL_RMT_BLOCK_SYMBOLS 64
+#endif
+
+// Longest half of an RMT symbol in ticks.
+#define RTTTL_RMT_DURATION_MAX 0x7FFF
+
+// Turns a song into RMT symbols: one symbol per period of each note's square
+// wave and long low symbols for pauses. Symbols are 32 bit words in the RMT
+// memory layout (duration0:15, level0:1, duration1:15, level1:1), made on
+// demand a buffer at a time so the hardware can play a whole song while the
+// CPU only refills its memory. Note edges are placed from the start of the
+// song, so rounding never adds up. Does not depend on any ESP32 API; the host
+// can render the same symbols to check them.
+class RTTTLRmtEncoder {
+
+private:
+  RTTTLSequencer sequencer;
+  uint32_t resolution;
+  uint8_t level = 100;       // percent of the loudest
+  uint16_t frequency = 0;
+  uint16_t share = 0;        // part of each period that is high, 1/65536
+  uint32_t accumulator = 0;  // ticks carried between periods
+  uint64_t position = 0;     // ticks encoded so far
+  uint64_t soundEnd = 0;
+  uint64_t noteEnd = 0;
+  uint64_t songTime = 0;     // ms of song encoded so far
+  bool active = false;
+
+  bool nextNote();
+
+public:
+  RTTTLRmtEncoder(uint32_t resolution = RTTTL_RMT_RESOLUTION) : resolution(resolution) { }
+
+  // Load songs and set the tempo here, then start().
+  RTTTLSequencer &song() { return sequencer; }
+  // Percent of the loudest, which is half of each period high.
+  void setLevel(uint8_t percent) { level = percent < 100 ? percent : 100; }
+  uint32_t ticksPerSecond() const { return resolution; }
+  // Lowest frequency whose period fits one symbol at any level; lower notes
+  // are silent.
+  uint32_t minFrequency() const { return resolution / RTTTL_RMT_DURATION_MAX + 1; }
+
+  void start();
+  bool done() const { return !active; }
+  // Fills up to max symbols and returns how many, 0 once the song is over.
+  size_t encode(uint32_t *symbols, size_t max);
+
+  static uint32_t symbol(uint16_t duration0, bool level0, uint16_t duration1, bool level1) {
+    return (uint32_t)duration0 | ((uint32_t)level0 << 15) | ((uint32_t)duration1 << 16) | ((uint32_t)level1 << 31);
+  }
+};
+
+#endif
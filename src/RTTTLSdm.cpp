@@ -0,0 +1,119 @@
+/*
+ * Sigma-delta output for the RTTTL player.
+ */
+
+#include "RTTTLSdm.h"
+
+#if RTTTL_SDM_SUPPORTED
+
+// pulse density of the low half of the wave, the pin stays low
+#define RTTTL_SDM_LOW -128
+
+RTTTLSdmOutput::RTTTLSdmOutput(const gpio_num_t pin) {
+  this->pin = pin;
+}
+
+RTTTLSdmOutput::~RTTTLSdmOutput() {
+  end();
+}
+
+bool RTTTL_SDM_ISR_ATTR RTTTLSdmOutput::flip(gptimer_handle_t timer, const gptimer_alarm_event_data_t *event, void *arg) {
+  RTTTLSdmOutput *self = (RTTTLSdmOutput*)arg;
+  (void)timer;
+  (void)event;
+  self->high = !self->high;
+  sdm_channel_set_pulse_density(self->channel, self->high ? self->highDensity : RTTTL_SDM_LOW);
+  return false;
+}
+
+bool RTTTLSdmOutput::begin() {
+  if (channel != nullptr) {
+    return true;
+  }
+
+  sdm_config_t sdmConfig = {};
+  sdmConfig.gpio_num = pin;
+  sdmConfig.clk_src = SDM_CLK_SRC_DEFAULT;
+  sdmConfig.sample_rate_hz = RTTTL_SDM_SAMPLE_RATE;
+  if (sdm_new_channel(&sdmConfig, &channel) != ESP_OK) {
+    channel = nullptr;
+    return false;
+  }
+
+  gptimer_config_t timerConfig = {};
+  timerConfig.clk_src = GPTIMER_CLK_SRC_DEFAULT;
+  timerConfig.direction = GPTIMER_COUNT_UP;
+  timerConfig.resolution_hz = RTTTL_SDM_TIMER_RESOLUTION;
+  gptimer_event_callbacks_t callbacks = {};
+  callbacks.on_alarm = flip;
+  if (gptimer_new_timer(&timerConfig, &timer) != ESP_OK) {
+    timer = nullptr;
+    end();
+    return false;
+  }
+  if (gptimer_register_event_callbacks(timer, &callbacks, this) != ESP_OK ||
+      gptimer_enable(timer) != ESP_OK || sdm_channel_enable(channel) != ESP_OK) {
+    end();
+    return false;
+  }
+  sdm_channel_set_pulse_density(channel, RTTTL_SDM_LOW);
+  return true;
+}
+
+void RTTTLSdmOutput::end() {
+  if (timer != nullptr) {
+    if (running) {
+      gptimer_stop(timer);
+      running = false;
+    }
+    gptimer_disable(timer);
+    gptimer_del_timer(timer);
+    timer = nullptr;
+  }
+  if (channel != nullptr) {
+    sdm_channel_disable(channel);
+    sdm_del_channel(channel);
+    channel = nullptr;
+    gpio_reset_pin(pin);
+  }
+}
+
+bool RTTTLSdmOutput::tone(uint16_t frequency) {
+  if (frequency == 0 || frequency > RTTTL_SDM_MAX_FREQUENCY) {
+    return false;
+  }
+  retune(frequency);
+  return true;
+}
+
+void RTTTLSdmOutput::retune(uint32_t frequency) {
+  if (frequency > RTTTL_SDM_MAX_FREQUENCY) frequency = RTTTL_SDM_MAX_FREQUENCY;
+  if (frequency == 0) frequency = 1;
+
+  // the interrupt fires twice a period. An alarm below the running count
+  // fires at once, so a shorter period never waits for the count to wrap
+  gptimer_alarm_config_t alarm = {};
+  alarm.alarm_count = (RTTTL_SDM_TIMER_RESOLUTION / 2 + frequency / 2) / frequency;
+  alarm.reload_count = 0;
+  alarm.flags.auto_reload_on_alarm = true;
+  gptimer_set_alarm_action(timer, &alarm);
+}
+
+void RTTTLSdmOutput::setDuty(uint32_t duty) {
+  int32_t density = RTTTL_SDM_LOW + (int32_t)(duty < 255 ? duty : 255);
+  highDensity = (int8_t)density;
+
+  // the interrupt only runs while there is something to hear
+  if (duty == 0 && running) {
+    gptimer_stop(timer);
+    running = false;
+    high = false;
+    sdm_channel_set_pulse_density(channel, RTTTL_SDM_LOW);
+  } else if (duty != 0 && !running) {
+    gptimer_set_raw_count(timer, 0);
+    gptimer_start(timer);
+    running = true;
+  }
+}
+
+#endif
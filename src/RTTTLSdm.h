@@ -0,0 +1,92 @@
+#ifndef RTTTLSdm_h
+#define RTTTLSdm_h
+
+#include <sdkconfig.h>
+#include <esp_idf_version.h>
+#include <soc/soc_caps.h>
+
+// Setting the pulse density from an interrupt needs the sigma-delta driver
+// of ESP-IDF 5.1. An IRAM safe GPTimer interrupt may only call
+// sdm_channel_set_pulse_density() when that is in IRAM too.
+#if SOC_SDM_SUPPORTED && ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0) && \
+    (!CONFIG_GPTIMER_ISR_IRAM_SAFE || CONFIG_SDM_CTRL_FUNC_IN_IRAM)
+#define RTTTL_SDM_SUPPORTED 1
+#else
+#define RTTTL_SDM_SUPPORTED 0
+#endif
+
+#if RTTTL_SDM_SUPPORTED
+
+#include <driver/gpio.h>
+#include <driver/gptimer.h>
+#include <driver/sdm.h>
+#include <esp_attr.h>
+
+#include "RTTTLOutput.h"
+
+// The flip interrupt only goes to IRAM when the GPTimer interrupt runs with
+// the flash cache off; otherwise it stays in flash like the driver call in it.
+#if CONFIG_GPTIMER_ISR_IRAM_SAFE
+#define RTTTL_SDM_ISR_ATTR IRAM_ATTR
+#else
+#define RTTTL_SDM_ISR_ATTR
+#endif
+
+// Pulse rate of the sigma-delta modulator. It has to be well above the
+// highest note so a low pass filter or the speaker itself can smooth it out.
+#ifndef RTTTL_SDM_SAMPLE_RATE
+#define RTTTL_SDM_SAMPLE_RATE 1000000
+#endif
+
+// Ticks per second of the timer that flips the wave. A half period is
+// rounded to a whole tick, less than 1 cent off up to 5 kHz at the default.
+#ifndef RTTTL_SDM_TIMER_RESOLUTION
+#define RTTTL_SDM_TIMER_RESOLUTION 10000000
+#endif
+
+// Highest note the SDM output plays. Every half period costs an interrupt.
+#ifndef RTTTL_SDM_MAX_FREQUENCY
+#define RTTTL_SDM_MAX_FREQUENCY 10000
+#endif
+
+// Plays through a sigma-delta channel, for boards whose LEDC timers and
+// MCPWM are all taken; it only needs one of the many SDM channels and a
+// general purpose timer. The modulator has no notion of a period, so a timer
+// interrupt flips the pulse density between the two levels of the square
+// wave every half period: that is 2 x frequency interrupts a second while a
+// note sounds, about 1% of a core per kHz, and nothing while silent. A note
+// itself costs one alarm update. Plays from 1 Hz to RTTTL_SDM_MAX_FREQUENCY.
+// The output is a pulse train at RTTTL_SDM_SAMPLE_RATE and wants an RC low
+// pass in front of an amplifier; a piezo filters it well enough on its own.
+// There is no fade hardware, so envelope ramps jump to each level. Needs
+// ESP-IDF 5.1, and CONFIG_SDM_CTRL_FUNC_IN_IRAM as well when
+// CONFIG_GPTIMER_ISR_IRAM_SAFE is set.
+class RTTTLSdmOutput : public RTTTLOutput {
+
+private:
+  gpio_num_t pin;
+  sdm_channel_handle_t channel = nullptr;
+  gptimer_handle_t timer = nullptr;
+  volatile int8_t highDensity = -128;
+  volatile bool high = false;
+  bool running = false;
+
+  static bool flip(gptimer_handle_t timer, const gptimer_alarm_event_data_t *event, void *arg);
+
+public:
+  RTTTLSdmOutput(const gpio_num_t pin);
+  ~RTTTLSdmOutput();
+
+  bool begin() override;
+  void end() override;
+  bool tone(uint16_t frequency) override;
+  void retune(uint32_t frequency) override;
+  // The density of the high half goes up one step per unit of duty, so half
+  // of the scale swings the wave from fully low to fully high.
+  uint32_t fullScale() const override { return 510; }
+  void setDuty(uint32_t duty) override;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Platform independent note scheduling for the RTTTL player.
+ */
+
+#include "RTTTLSequencer.h"
+
+bool RTTTLSequencer::load(const char *song, RTTTLFrontEnd *format) {
+  compiled = nullptr;
+  compiledCount = 0;
+  index = 0;
+  source = format != nullptr ? format : &parser;
+  loopsLeft = 0;
+  songTime = noteTime = 0;
+  loaded = source->load(song);
+  loops = source->loops();
+  return loaded;
+}
+
+bool RTTTLSequencer::load(const RTTTLSong &song) {
+  compiled = song.notes;
+  compiledCount = song.count;
+  index = 0;
+  loops = song.loops;
+  loopsLeft = 0;
+  songTime = noteTime = 0;
+  loaded = compiled != nullptr;
+  return loaded;
+}
+
+void RTTTLSequencer::rewind() {
+  index = 0;
+  if (compiled == nullptr) {
+    source->rewind();
+  }
+}
+
+void RTTTLSequencer::scan(void (*visit)(const RTTTLNote &note, void *arg), void *arg) {
+  RTTTLNote note;
+
+  if (!loaded) {
+    return;
+  }
+  rewind();
+  while (fetch(note)) {
+    visit(note, arg);
+    if (compiled != nullptr) {
+      index++;
+    }
+  }
+  rewind();
+}
+
+void RTTTLSequencer::start(int64_t now) {
+  rewind();
+  loopsLeft = loops;
+  songTime = noteTime = 0;
+  deadline = now;
+}
+
+bool RTTTLSequencer::fetch(RTTTLNote &note) {
+  if (compiled != nullptr) {
+    if (index >= compiledCount) {
+      return false;
+    }
+    note = compiled[index];
+    return true;
+  }
+  return source->nextNote(note);
+}
+
+bool RTTTLSequencer::nextNote(RTTTLNote &note) {
+  if (!loaded) {
+    return false;
+  }
+
+  if (!fetch(note)) {
+    // repeats play the stored notes again instead of expanded copies
+    if (loopsLeft == 0) {
+      return false;
+    }
+    if (loopsLeft != RTTTL_LOOP_FOREVER) {
+      loopsLeft--;
+    }
+    rewind();
+    if (!fetch(note)) {
+      return false;
+    }
+  }
+
+  index++;
+  songTime += noteTime;
+  noteTime = note.duration;
+  if (tempo != 100) {
+    uint64_t scaled = (uint64_t)note.duration * 100 / tempo;
+    note.duration = scaled > UINT32_MAX ? UINT32_MAX : (uint32_t)scaled;
+  }
+  // schedule from the previous deadline rather than from now so late notes
+  // do not push the rest of the song back
+  deadline += (int64_t)note.duration * 1000;
+  return true;
+}
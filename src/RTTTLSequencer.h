@@ -0,0 +1,58 @@
+#ifndef RTTTLSequencer_h
+#define RTTTLSequencer_h
+
+#include "RTTTLParser.h"
+
+// Steps through a song and keeps track of when the next note is due. Times are
+// in microseconds on whatever clock the caller uses, so the same logic runs on
+// the ESP32 and on the host.
+class RTTTLSequencer {
+
+private:
+  RTTTLParser parser;
+  RTTTLFrontEnd * source = &parser;
+  const RTTTLNote * compiled = nullptr;
+  size_t compiledCount = 0;
+  size_t index = 0;
+  bool loaded = false;
+  int64_t deadline = 0;
+  int tempo = 100;
+  uint8_t loops = 0;
+  uint8_t loopsLeft = 0;
+  uint32_t songTime = 0;
+  uint32_t noteTime = 0;
+
+  bool fetch(RTTTLNote &note);
+
+public:
+  // Text songs are read with format, or as RTTTL when it is null.
+  bool load(const char *song, RTTTLFrontEnd *format = nullptr);
+  bool load(const RTTTLSong &song);
+  bool isLoaded() const { return loaded; }
+  void rewind();
+  // Playback speed in percent of the song's own tempo.
+  void setTempo(int percent) { if (percent > 0) tempo = percent; }
+
+  // Calls visit with every note of the song once, then rewinds. Does not touch
+  // the schedule.
+  void scan(void (*visit)(const RTTTLNote &note, void *arg), void *arg);
+
+  // Makes the first note due at now.
+  void start(int64_t now);
+  bool due(int64_t now) const { return now >= deadline; }
+  int64_t nextDeadline() const { return deadline; }
+  // Number of notes fetched since the song was started.
+  size_t notesPlayed() const { return index; }
+  // Where the note fetched last starts and how long it is, in ms at the
+  // song's own tempo. The start counts from start(), repeats included.
+  uint32_t noteStart() const { return songTime; }
+  uint32_t noteLength() const { return noteTime; }
+  uint8_t loopCount() const { return loops; }
+
+  // Fetches the note that is due and schedules the one after it. Songs with a
+  // loop count start over from the first note. Returns false once the song is
+  // over.
+  bool nextNote(RTTTLNote &note);
+};
+
+#endif
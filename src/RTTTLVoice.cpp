@@ -0,0 +1,158 @@
+/*
+ * Platform independent note stepping and effect timing for the RTTTL player.
+ */
+
+#include "RTTTLVoice.h"
+
+void RTTTLVoice::setEffectRate(uint16_t rate) {
+  effectRate = rate ? rate : RTTTL_EFFECT_RATE;
+  lfoInterval = 1000000 / effectRate;
+}
+
+void RTTTLVoice::load(const char *text, RTTTLFrontEnd *format) {
+  sweepMode = false;
+  lastFrequency = 0;
+  sequencer.load(text, format);
+}
+
+void RTTTLVoice::load(const RTTTLSong &song) {
+  sweepMode = false;
+  lastFrequency = 0;
+  sequencer.load(song);
+}
+
+struct RTTTLPlan {
+  RTTTLOutput * output;
+  RTTTLSongInfo info;
+};
+
+static void planNote(const RTTTLNote &note, void *arg) {
+  RTTTLPlan *plan = (RTTTLPlan*)arg;
+  plan->output->prepare(note.frequency);
+  plan->info.add(note);
+}
+
+void RTTTLVoice::plan(RTTTLOutput &output) {
+  RTTTLPlan plan;
+
+  // let the output work out every note of the song now rather than while
+  // playing, and take the length for the progress from the same pass
+  plan.output = &output;
+  output.clear();
+  sequencer.scan(planNote, &plan);
+  playhead.setLength(plan.info.duration / 1000, sequencer.loopCount());
+}
+
+void RTTTLVoice::sweep(uint16_t from, uint16_t to, uint32_t ms, RTTTLSweepCurve curve, int64_t now) {
+  // a one note song that glides over its whole length
+  RTTTLSong song;
+  sweepNote.frequency = to;
+  sweepNote.duration = ms;
+  song.notes = &sweepNote;
+  song.count = 1;
+  sequencer.load(song);
+  sequencer.start(now);
+  playhead.setLength(ms, 0);
+  sweepMode = true;
+  sweepFrom = from;
+  sweepCurve = curve;
+}
+
+void RTTTLVoice::setPortamento(uint16_t ms, RTTTLSweepCurve curve) {
+  portamento = ms;
+  portamentoCurve = curve;
+}
+
+void RTTTLVoice::stop() {
+  playhead.stop();
+  glide.stop();
+  lastFrequency = 0;
+  sequencer.rewind();
+}
+
+int64_t RTTTLVoice::nextDeadline(bool sounding) const {
+  int64_t deadline = sequencer.nextDeadline();
+  if (glide.active() && glideDeadline < deadline) {
+    deadline = glideDeadline;
+  }
+  if (sounding && (vibratoLfo.enabled() || tremoloLfo.enabled()) && lfoDeadline < deadline) {
+    deadline = lfoDeadline;
+  }
+  return deadline;
+}
+
+bool RTTTLVoice::next(RTTTLVoiceNote &step) {
+  step.scheduled = sequencer.nextDeadline();
+  if (!sequencer.nextNote(step.note)) {
+    return false;
+  }
+  const RTTTLNote &note = step.note;
+  step.index = sequencer.notesPlayed() - 1;
+  playhead.publish(step.index, sequencer.noteStart(), sequencer.noteLength(), note.duration, step.scheduled);
+
+  // staccato and natural notes only sound for part of their time
+  step.length = note.duration;
+  if (note.gate != 0 && note.gate < 100) {
+    step.length = (uint64_t)step.length * note.gate / 100;
+  }
+
+  step.from = 0;
+  step.glideTime = 0;
+  step.curve = portamentoCurve;
+  if (note.frequency) {
+    if (sweepMode) {
+      step.from = sweepFrom;
+      step.glideTime = step.length;
+      step.curve = sweepCurve;
+    } else if (portamento && lastFrequency) {
+      step.from = lastFrequency;
+      step.glideTime = portamento < step.length ? portamento : step.length;
+    }
+  }
+  // pauses break the glide
+  lastFrequency = note.frequency;
+  return true;
+}
+
+void RTTTLVoice::startNote(const RTTTLVoiceNote &step) {
+  if (step.from) {
+    // 64 bit so long glides at high rates cannot wrap
+    uint64_t steps = (uint64_t)step.glideTime * effectRate / 1000;
+    if (steps == 0) steps = 1;
+    if (steps > UINT32_MAX) steps = UINT32_MAX;
+
+    glide.start(step.from, step.note.frequency, (uint32_t)steps, step.curve);
+    glideInterval = (uint32_t)((uint64_t)step.glideTime * 1000 / steps);
+    glideDeadline = step.scheduled + glideInterval;
+  }
+  // every note starts its vibrato and tremolo from the centre
+  vibratoLfo.reset();
+  tremoloLfo.reset();
+  lfoDeadline = step.scheduled + lfoInterval;
+}
+
+bool RTTTLVoice::stepGlide(int64_t now, uint16_t &frequency) {
+  if (!glide.active() || now < glideDeadline) {
+    return false;
+  }
+
+  // catch up on missed steps but only hand out the latest frequency
+  while (glide.active() && now >= glideDeadline) {
+    frequency = glide.next();
+    glideDeadline += glideInterval;
+  }
+  return true;
+}
+
+uint32_t RTTTLVoice::stepLfo(int64_t now) {
+  if (now < lfoDeadline) {
+    return 0;
+  }
+
+  // a late wake up moves the phase on by every step it missed
+  uint32_t steps = (now - lfoDeadline) / lfoInterval + 1;
+  lfoDeadline += (int64_t)steps * lfoInterval;
+  vibratoLfo.advance(steps);
+  tremoloLfo.advance(steps);
+  return steps;
+}
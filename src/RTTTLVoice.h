@@ -0,0 +1,97 @@
+#ifndef RTTTLVoice_h
+#define RTTTLVoice_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "RTTTLEffects.h"
+#include "RTTTLOutput.h"
+#include "RTTTLProgress.h"
+#include "RTTTLSequencer.h"
+
+// A note that came due, as the voice hands it to the output side.
+struct RTTTLVoiceNote {
+  RTTTLNote note;
+  size_t index;        // position in the song, pauses included
+  int64_t scheduled;   // when it was due
+  uint32_t length;     // ms it sounds, less than the duration when staccato
+  uint16_t from;       // Hz a glide into the note starts at, 0 for none
+  uint32_t glideTime;  // ms of that glide
+  RTTTLSweepCurve curve;
+};
+
+// The part of playback that decides what sounds when: loads songs and sweeps
+// and plans them for the output, steps through their notes with portamento,
+// and keeps the glide and the vibrato and tremolo oscillators on schedule.
+// It touches neither the RTOS nor a peripheral and takes the time from its
+// caller in microseconds, so the playback task and the host bench run the
+// same code.
+class RTTTLVoice {
+
+private:
+  RTTTLSequencer sequencer;
+  RTTTLProgress playhead;
+  RTTTLSweep glide;
+  int64_t glideDeadline = 0;
+  uint32_t glideInterval = 0;
+  uint16_t lastFrequency = 0;
+  uint16_t portamento = 0;
+  RTTTLSweepCurve portamentoCurve = RTTTL_SWEEP_EXPONENTIAL;
+  RTTTLNote sweepNote = {};
+  bool sweepMode = false;
+  uint16_t sweepFrom = 0;
+  RTTTLSweepCurve sweepCurve = RTTTL_SWEEP_EXPONENTIAL;
+  RTTTLLfo vibratoLfo;
+  RTTTLLfo tremoloLfo;
+  int64_t lfoDeadline = 0;
+  uint32_t lfoInterval = 1000000 / RTTTL_EFFECT_RATE;
+  uint16_t effectRate = RTTTL_EFFECT_RATE;
+
+public:
+  // Output updates per second for glides and the oscillators, 0 for the
+  // default.
+  void setEffectRate(uint16_t rate);
+
+  // Set the tempo and read the song here.
+  RTTTLSequencer &song() { return sequencer; }
+  // Where playback is, written at every note.
+  RTTTLProgress &progress() { return playhead; }
+  const RTTTLLfo &vibrato() const { return vibratoLfo; }
+  const RTTTLLfo &tremolo() const { return tremoloLfo; }
+
+  void load(const char *text, RTTTLFrontEnd *format);
+  void load(const RTTTLSong &song);
+  // Hands every frequency of the loaded song to the output and takes its
+  // length for the progress, in one pass.
+  void plan(RTTTLOutput &output);
+  // Replaces the song with one tone gliding from one frequency to the other
+  // over ms, started at now.
+  void sweep(uint16_t from, uint16_t to, uint32_t ms, RTTTLSweepCurve curve, int64_t now);
+  void setPortamento(uint16_t ms, RTTTLSweepCurve curve);
+  void setVibrato(uint32_t milliHertz, int32_t depth) { vibratoLfo.set(milliHertz, effectRate, depth); }
+  void setTremolo(uint32_t milliHertz, int32_t depth) { tremoloLfo.set(milliHertz, effectRate, depth); }
+
+  void start(int64_t now) { sequencer.start(now); }
+  // Back to the start of the song, with nothing sounding.
+  void stop();
+  void stopGlide() { glide.stop(); }
+
+  bool due(int64_t now) const { return sequencer.due(now); }
+  // Earliest of the next note and, while a note sounds, the next glide or
+  // oscillator step.
+  int64_t nextDeadline(bool sounding) const;
+
+  // Fetches the note that is due and publishes it to the progress. Returns
+  // false once the song is over.
+  bool next(RTTTLVoiceNote &step);
+  // Starts the glide and the oscillators of a note from next() that sounds.
+  void startNote(const RTTTLVoiceNote &step);
+  // Moves the glide on to now, catching up on missed steps. Returns true
+  // with the latest frequency when it moved.
+  bool stepGlide(int64_t now, uint16_t &frequency);
+  // Moves the oscillators on to now. Returns the number of steps taken, 0
+  // when none was due.
+  uint32_t stepLfo(int64_t now);
+};
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef RTTTLVolume_h
+#define RTTTLVolume_h
+
+// Volume at which the output is driven at 50% duty, the loudest setting.
+// Shared by every player.
+#ifndef RTTTL_MAX_VOLUME
+#define RTTTL_MAX_VOLUME 10
+#endif
+
+#endif